@@ -0,0 +1,118 @@
+/**
+ * ======================================================================================
+ * ANCHOR FILES (keyframed pin motion -> Cloth::anchors)
+ * ======================================================================================
+ *
+ * A small line-based text format describing AnchorTracks, so animated
+ * rigs (a sliding curtain rail, a swaying flag pole) need no code:
+ *
+ *   # Slide the whole rail right and back every 6 seconds
+ *   track smooth loop          # linear|smooth, loop|once (defaults: linear loop)
+ *   points pins                # the points pinned when the file is loaded
+ *   key 0   0 0 0              # time (s), then x y z offset from the rest position
+ *   key 3 300 0 0
+ *   key 6   0 0 0
+ *
+ *   track linear once
+ *   points 0 70 140 210        # explicit point indices
+ *   key 0 0 0 0
+ *   key 2 0 0 -80
+ *
+ * `points` may repeat to add more points to the current track. Keys must
+ * be in increasing time order.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include "cloth.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * ------------------------------------------------------------------
+ * FUNCTION: loadAnchors
+ * Parses `path` and binds its tracks to `cloth` (after the cloth is
+ * built). On failure returns false with a message in `error` and
+ * binds nothing.
+ * ------------------------------------------------------------------
+ */
+inline bool loadAnchors(const std::string &path, Cloth &cloth, std::string &error)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        error = "Could not open " + path;
+        return false;
+    }
+
+    std::vector<AnchorTrack> tracks;
+    std::string line;
+    for (int number = 1; std::getline(in, line); number++)
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string word;
+        if (!(words >> word))
+            continue;
+
+        auto fail = [&](const std::string &what)
+        {
+            error = path + ":" + std::to_string(number) + ": " + what;
+            return false;
+        };
+        if (word != "track" && tracks.empty())
+            return fail("expected 'track'");
+
+        if (word == "track")
+        {
+            tracks.emplace_back();
+            while (words >> word)
+            {
+                if (word == "linear" || word == "smooth")
+                    tracks.back().smooth = word == "smooth";
+                else if (word == "loop" || word == "once")
+                    tracks.back().loop = word == "loop";
+                else
+                    return fail("unknown track option '" + word + "'");
+            }
+        }
+        else if (word == "points")
+        {
+            std::vector<uint32_t> &points = tracks.back().points;
+            while (words >> word)
+            {
+                if (word == "pins")
+                {
+                    for (const Pin &p : cloth.pins)
+                        points.push_back(p.point);
+                    continue;
+                }
+                char *end = nullptr;
+                unsigned long index = std::strtoul(word.c_str(), &end, 10);
+                if (*end != '\0' || index >= cloth.points.size())
+                    return fail("bad point '" + word + "'");
+                points.push_back(static_cast<uint32_t>(index));
+            }
+        }
+        else if (word == "key")
+        {
+            Keyframe key;
+            if (!(words >> key.time >> key.offset.x >> key.offset.y >> key.offset.z))
+                return fail("expected 'key time x y z'");
+            std::vector<Keyframe> &keys = tracks.back().keys;
+            if (!keys.empty() && key.time <= keys.back().time)
+                return fail("keys must be in increasing time order");
+            keys.push_back(key);
+        }
+        else
+            return fail("unknown record '" + word + "'");
+    }
+
+    for (AnchorTrack &track : tracks)
+        cloth.bindTrack(std::move(track));
+    return true;
+}
@@ -0,0 +1,394 @@
+/**
+ * ======================================================================================
+ * SCALABILITY BENCHMARK (Headless sweep over size x solver x threads x pages)
+ * ======================================================================================
+ *
+ * For every cloth size, solver mode, thread count and page policy
+ * (memory.hpp), builds the cloth, steps it for at least `seconds` of wall
+ * time and records (solver "compact" runs the coloured solver on a
+ * CompactCloth, compact.hpp; solver "grid" on a GridCloth, grid.hpp)
+ *
+ *   steps_per_s   frames simulated per second
+ *   ns_per_link   wall time per link per solver iteration
+ *   mem_bytes     bytes held by the point and link arrays
+ *   rss_kb        resident set size of the process after the run
+ *   ipc, llc_miss_per_link, branch_miss_per_link, dtlb_miss_per_link
+ *                 hardware counters of the calling thread (perfcounters.hpp);
+ *                 with T threads it handles ~1/T of the links, so the
+ *                 per-link values divide by links / T. Empty if unavailable.
+ *
+ * With `pinThreads` every worker is bound to its own CPU before the cloth
+ * is built, so first touch puts each worker's pages on its NUMA node.
+ *
+ * Rows go to a CSV. Given a previous CSV as baseline, the matching rows are
+ * compared and any configuration that got slower than the tolerance allows
+ * is reported (and the exit code is non-zero, for CI).
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include "cli.hpp"
+#include "cloth.hpp"
+#include "compact.hpp"
+#include "grid.hpp"
+#include "perfcounters.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__)
+#include <unistd.h>
+#endif
+
+struct BenchConfig
+{
+    std::vector<std::string> sizes{"70x45", "256x256", "1024x1024", "4000x4000"};
+    std::vector<unsigned> threads;      // Empty = 1, 2, 4, ... up to every core
+    std::vector<std::string> solvers{"serial", "colored"};
+    std::vector<std::string> pages{"default"}; // Page policies (memory.hpp)
+    bool pinThreads = false;
+    double seconds = 2.0;               // Minimum measured wall time per row
+    int minFrames = 5;                  // ...and minimum frames per row
+    std::string outPath = "bench.csv";
+    std::string baselinePath;           // Compare against this earlier report
+    double tolerance = 0.05;            // Allowed slowdown before a row counts as a regression
+};
+
+struct BenchRow
+{
+    int width = 0, height = 0;
+    std::string solver;
+    unsigned threads = 1;
+    std::string pages = "default";
+    int frames = 0;
+    double stepsPerSec = 0.0;
+    double nsPerLink = 0.0;
+    size_t memBytes = 0;
+    double rssKb = 0.0;
+    double ipc = NAN, llcPerLink = NAN, branchPerLink = NAN, dtlbPerLink = NAN;
+
+    std::string key() const
+    {
+        return std::to_string(width) + "x" + std::to_string(height) + "/" + solver + "/" + std::to_string(threads) +
+               "/" + pages;
+    }
+};
+
+inline double residentKb()
+{
+#if defined(__unix__)
+    std::ifstream statm("/proc/self/statm");
+    double pages = 0.0, resident = 0.0;
+    if (statm >> pages >> resident)
+        return resident * sysconf(_SC_PAGESIZE) / 1024.0;
+#endif
+    return NAN;
+}
+
+inline BenchRow benchOne(int width, int height, const std::string &solver, unsigned threads, PagePolicy pages,
+                         const BenchConfig &cfg)
+{
+    BenchRow row;
+    row.width = width;
+    row.height = height;
+    row.solver = solver;
+    row.threads = threads;
+    row.pages = pagePolicyName(pages);
+    pagePolicy() = pages;
+
+    bool compact = solver == "compact", grid = solver == "grid";
+    SimParams params;
+    params.solver = SolverMode::Colored;
+    if (!compact && !grid)
+        parseSolverMode(solver, params.solver);
+    WorkerPool pool(threads);
+    if (cfg.pinThreads)
+        pool.pinThreads();
+    Cloth cloth;
+    cloth.pool = &pool;
+    cloth.buildGrid(width, height);
+    CompactCloth packed;
+    if (compact)
+    {
+        cloth.sortByColor();
+        packed.pool = &pool;
+        packed.load(cloth);
+        cloth.clear(); // Only the compact copy is simulated
+    }
+    GridCloth implicit;
+    if (grid)
+    {
+        implicit.pool = &pool;
+        implicit.load(cloth, width, height);
+        cloth.clear();
+    }
+    auto step = [&](int frame)
+    {
+        if (compact)
+            packed.step(frame * FRAME_TIME * 1.5f, params);
+        else if (grid)
+            implicit.step(frame * FRAME_TIME * 1.5f, params);
+        else
+            cloth.step(frame * FRAME_TIME * 1.5f, params);
+    };
+
+    // Warm-up: faults the pages in and lets the coloured solver sort its links
+    for (int frame = 0; frame < 2; frame++)
+        step(frame);
+
+    size_t links = compact ? packed.rest.size()
+                   : grid  ? static_cast<size_t>(width - 1) * height + static_cast<size_t>(height - 1) * width
+                           : cloth.links.size();
+    PerfCounters counters;
+    PerfSample before = counters.read();
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    int frame = 0;
+    while (frame < cfg.minFrames || elapsed < cfg.seconds)
+    {
+        step(frame + 2);
+        frame++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    PerfSample after = counters.read();
+
+    row.frames = frame;
+    row.stepsPerSec = frame / elapsed;
+    row.nsPerLink = elapsed * 1e9 / frame / (static_cast<double>(links) * params.iterations);
+    row.memBytes = compact ? packed.memoryBytes()
+                   : grid  ? implicit.memoryBytes()
+                           : cloth.points.capacity() * sizeof(Point) + cloth.links.capacity() * sizeof(Link);
+    row.rssKb = residentKb();
+
+    double share = static_cast<double>(frame) * links / threads; // Link-frames handled by this thread
+    auto delta = [&](PerfCounter c) { return static_cast<double>(after[c] - before[c]); };
+    if (counters.available(PERF_CYCLES) && counters.available(PERF_INSTRUCTIONS) && delta(PERF_CYCLES) > 0)
+        row.ipc = delta(PERF_INSTRUCTIONS) / delta(PERF_CYCLES);
+    if (counters.available(PERF_LLC_MISSES))
+        row.llcPerLink = delta(PERF_LLC_MISSES) / share;
+    if (counters.available(PERF_BRANCH_MISSES))
+        row.branchPerLink = delta(PERF_BRANCH_MISSES) / share;
+    if (counters.available(PERF_DTLB_MISSES))
+        row.dtlbPerLink = delta(PERF_DTLB_MISSES) / share;
+    pagePolicy() = PagePolicy::Default;
+    return row;
+}
+
+inline const char *BENCH_CSV_HEADER =
+    "width,height,solver,threads,pages,frames,steps_per_s,ns_per_link,mem_bytes,rss_kb,ipc,llc_miss_per_link,"
+    "branch_miss_per_link,dtlb_miss_per_link";
+
+// Empty field for values that were not measured
+inline std::string benchField(double v)
+{
+    if (std::isnan(v))
+        return "";
+    std::ostringstream os;
+    os << v;
+    return os.str();
+}
+
+inline bool writeBenchCsv(const std::string &path, const std::vector<BenchRow> &rows)
+{
+    std::ofstream out(path);
+    if (!out)
+        return false;
+    out << BENCH_CSV_HEADER << '\n';
+    for (const BenchRow &r : rows)
+    {
+        out << r.width << ',' << r.height << ',' << r.solver << ',' << r.threads << ',' << r.pages << ','
+            << r.frames << ',' << r.stepsPerSec << ',' << r.nsPerLink << ',' << r.memBytes << ','
+            << benchField(r.rssKb) << ',' << benchField(r.ipc) << ',' << benchField(r.llcPerLink) << ','
+            << benchField(r.branchPerLink) << ',' << benchField(r.dtlbPerLink) << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+// Reads a report written by writeBenchCsv (columns looked up by name, so
+// reports from builds with extra columns still load). Key -> steps/s.
+inline bool readBenchBaseline(const std::string &path, std::map<std::string, double> &stepsPerSec)
+{
+    std::ifstream in(path);
+    std::string line;
+    if (!in || !std::getline(in, line))
+        return false;
+
+    std::vector<std::string> header;
+    std::stringstream hs(line);
+    for (std::string col; std::getline(hs, col, ',');)
+        header.push_back(col);
+
+    while (std::getline(in, line))
+    {
+        std::map<std::string, std::string> row;
+        std::stringstream ls(line);
+        std::string cell;
+        for (size_t i = 0; i < header.size() && std::getline(ls, cell, ','); i++)
+            row[header[i]] = cell;
+
+        BenchRow r;
+        r.width = std::atoi(row["width"].c_str());
+        r.height = std::atoi(row["height"].c_str());
+        r.solver = row["solver"];
+        r.threads = static_cast<unsigned>(std::atoi(row["threads"].c_str()));
+        if (!row["pages"].empty()) // Older reports ran everything on default pages
+            r.pages = row["pages"];
+        stepsPerSec[r.key()] = std::atof(row["steps_per_s"].c_str());
+    }
+    return true;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * FUNCTION: runBench
+ * Runs the whole grid, writes the report and, with a baseline, prints
+ * the comparison. Returns the process exit code (2 on regressions).
+ * ------------------------------------------------------------------
+ */
+inline int runBench(BenchConfig cfg)
+{
+    if (cfg.threads.empty())
+    {
+        unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned t = 1; t < cores; t *= 2)
+            cfg.threads.push_back(t);
+        cfg.threads.push_back(cores);
+    }
+
+    std::vector<BenchRow> rows;
+    std::printf("%-12s %-8s %7s %-8s %10s %10s %12s %6s %9s\n", "size", "solver", "threads", "pages", "steps/s",
+                "ns/link", "MB", "IPC", "TLB/link");
+    for (const std::string &size : cfg.sizes)
+    {
+        int width = 0, height = 0;
+        parseSize(size, width, height);
+        for (const std::string &name : cfg.solvers)
+        {
+            for (unsigned threads : cfg.threads)
+            {
+                if ((name == solverName(SolverMode::Serial) || name == solverName(SolverMode::Adaptive)) &&
+                    threads != 1)
+                    continue; // Single-threaded by definition
+
+                for (const std::string &pageName : cfg.pages)
+                {
+                    PagePolicy pages = PagePolicy::Default;
+                    parsePagePolicy(pageName, pages);
+                    rows.push_back(benchOne(width, height, name, threads, pages, cfg));
+                    const BenchRow &r = rows.back();
+                    std::printf("%-12s %-8s %7u %-8s %10.2f %10.3f %12.1f %6s %9s\n", size.c_str(), r.solver.c_str(),
+                                r.threads, r.pages.c_str(), r.stepsPerSec, r.nsPerLink, r.memBytes / (1024.0 * 1024.0),
+                                benchField(r.ipc).c_str(), benchField(r.dtlbPerLink).c_str());
+                    std::fflush(stdout);
+                }
+            }
+        }
+    }
+
+    if (!writeBenchCsv(cfg.outPath, rows))
+    {
+        std::cerr << "Could not write " << cfg.outPath << "\n";
+        return 1;
+    }
+    std::cout << "Wrote " << rows.size() << " rows to " << cfg.outPath << "\n";
+
+    if (cfg.baselinePath.empty())
+        return 0;
+
+    std::map<std::string, double> baseline;
+    if (!readBenchBaseline(cfg.baselinePath, baseline))
+    {
+        std::cerr << "Could not read baseline " << cfg.baselinePath << "\n";
+        return 1;
+    }
+
+    int regressions = 0;
+    std::printf("\n%-36s %12s %12s %8s\n", "config", "base steps/s", "steps/s", "speedup");
+    for (const BenchRow &r : rows)
+    {
+        auto it = baseline.find(r.key());
+        if (it == baseline.end() || it->second <= 0.0)
+            continue;
+        double speedup = r.stepsPerSec / it->second;
+        bool regressed = speedup < 1.0 - cfg.tolerance;
+        regressions += regressed;
+        std::printf("%-36s %12.2f %12.2f %7.2fx%s\n", r.key().c_str(), it->second, r.stepsPerSec, speedup,
+                    regressed ? "  REGRESSION" : "");
+    }
+    return regressions ? 2 : 0;
+}
+
+inline bool parseBenchArgs(int argc, char **argv, BenchConfig &cfg)
+{
+    for (int i = 0; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+
+        if (arg == "--sizes")
+        {
+            ok = parseList(value, cfg.sizes);
+            int w, h;
+            for (const std::string &s : cfg.sizes)
+                ok = ok && parseSize(s, w, h);
+        }
+        else if (arg == "--threads")
+            ok = parseThreadList(value, cfg.threads);
+        else if (arg == "--solvers")
+        {
+            ok = parseList(value, cfg.solvers);
+            SolverMode mode;
+            for (const std::string &s : cfg.solvers)
+                ok = ok && (parseSolverMode(s, mode) || s == "compact" || s == "grid");
+        }
+        else if (arg == "--pages")
+        {
+            ok = parseList(value, cfg.pages);
+            PagePolicy policy;
+            for (const std::string &p : cfg.pages)
+                ok = ok && parsePagePolicy(p, policy);
+        }
+        else if (arg == "--pin-threads")
+        {
+            ok = value == "on" || value == "off";
+            cfg.pinThreads = value == "on";
+        }
+        else if (arg == "--seconds")
+            cfg.seconds = std::atof(value.c_str());
+        else if (arg == "--min-frames")
+            cfg.minFrames = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--out")
+            cfg.outPath = value;
+        else if (arg == "--baseline")
+            cfg.baselinePath = value;
+        else if (arg == "--tolerance")
+            cfg.tolerance = std::atof(value.c_str());
+        else
+        {
+            std::cerr << "Unknown bench option " << arg << "\n";
+            return false;
+        }
+
+        if (!ok)
+        {
+            std::cerr << "Bad value for " << arg << ": " << value << "\n";
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+/**
+ * ======================================================================================
+ * COMMAND-LINE HELPERS
+ * ======================================================================================
+ *
+ * Value parsers shared by the headless modes (--ensemble, --bench, --converge).
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+const unsigned MAX_THREADS = 1024; // Upper bound for --threads lists
+
+// Parses "a,b,c" into a vector. Fails on empty lists or on items that do
+// not parse whole ("4x", "2.5" for an integer) or are negative for an
+// unsigned type (the stream would wrap "-1" around).
+template <typename T>
+bool parseList(const std::string &text, std::vector<T> &out)
+{
+    out.clear();
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        std::stringstream is(item);
+        if (std::is_unsigned<T>::value && (is >> std::ws).peek() == '-')
+            return false;
+        T value;
+        if (!(is >> value) || !(is >> std::ws).eof())
+            return false;
+        out.push_back(value);
+    }
+    return !out.empty();
+}
+
+// Parses a --threads list: every count in 1..MAX_THREADS.
+inline bool parseThreadList(const std::string &text, std::vector<unsigned> &out)
+{
+    if (!parseList(text, out))
+        return false;
+    for (unsigned t : out)
+        if (t < 1 || t > MAX_THREADS)
+            return false;
+    return true;
+}
+
+// Parses "WIDTHxHEIGHT", e.g. "70x45".
+inline bool parseSize(const std::string &text, int &width, int &height)
+{
+    char tail;
+    return std::sscanf(text.c_str(), "%dx%d%c", &width, &height, &tail) == 2 && width > 1 && height > 1;
+}
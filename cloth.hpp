@@ -0,0 +1,1795 @@
+/**
+ * ======================================================================================
+ * CLOTH CORE (Points, Links and the per-frame step)
+ * ======================================================================================
+ *
+ * Everything the physics needs, with no window attached. The interactive
+ * program (main.cpp) and the headless modes (ensemble sweeps, ...) all drive
+ * the same Cloth::step(), so a tuned parameter set behaves identically in both.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include "memory.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+// --- Configuration Constants ---
+const int WIDTH = 70;        // Number of points horizontally
+const int HEIGHT = 45;       // Number of points vertically
+const float DISTANCE = 18.f; // Resting distance between points
+const float GRAVITY = 0.35f; // Downward force per frame
+const float AIR_FRICTION = 0.98f; // Velocity damping factor. Lower value = more drag.
+const float STRETCH_LIMIT = 5.0f; // Multiplier for link breaking threshold
+const int ITERATIONS = 8;         // Solver passes per frame (per substep)
+const int SUBSTEPS = 1;           // Integrate + solve cycles per frame
+const float WIND = 0.15f;         // Amplitude of the sine wind on z, per frame
+const float Z_DAMPING = 0.99f;    // Pulls z back towards 0 each frame
+const float FRAME_TIME = 1.f / 60.f; // Seconds per frame at the window's framerate limit
+const int TILE_POINTS = 8;           // Edge of an adaptive-solver tile, in rest lengths
+const float TILE_THRESHOLD = 0.05f;  // Mean relative stretch above which a tile gets extra passes
+const float LINK_SNAPPED = -1.f;     // Link::solve() result when the link tears
+const float SPLIT_RESERVE = 0.25f;   // Spare point slots for TearMode::Split, per built point
+const int PIN_SPACING = 4;          // Gap between pins for PinPattern::Spaced
+
+/**
+ * ------------------------------------------------------------------
+ * ENUM: SolverMode
+ * How Cloth::step walks the links.
+ * ------------------------------------------------------------------
+ *
+ * Serial:  one Gauss-Seidel sweep over `links` in order, one thread.
+ * Colored: links are grouped into colours such that no two links of a
+ *          colour share a point; each colour is then solved in parallel
+ *          on the cloth's WorkerPool without races. The grid needs four:
+ *
+ *          P -0- P -1- P -0- P      0/1: horizontal links, by x parity
+ *          2     2     2     2      2/3: vertical links, by y parity
+ *          P -0- P -1- P -0- P
+ *          3     3     3     3
+ * Vertex:  points are grouped into colours such that no two linked points
+ *          share one (a checkerboard on the grid). Each point of a colour
+ *          gathers its links through the adjacency and moves itself, in
+ *          parallel: every point has exactly one writer.
+ * Chaotic: asynchronous relaxation. Each worker runs every iteration over
+ *          its own contiguous range of `links` with no barrier in between,
+ *          so workers drift apart by whole iterations. Points on a range
+ *          boundary are read and written by two workers at once through
+ *          relaxed atomics; an update can be lost or see a stale
+ *          position. On the grid the ranges are bands of rows, so only the
+ *          rows where two bands meet are shared.
+ * Adaptive: serial, but per tile of links (TILE_POINTS square). Every
+ *          tile gets one pass; tiles whose error is still above
+ *          `tileThreshold` get more, in top-to-bottom rounds, up to
+ *          `iterations` in total. A quiet cloth costs about one pass per frame, and a
+ *          grab or cut costs about the area it disturbs.
+ * ------------------------------------------------------------------
+ */
+enum class SolverMode
+{
+    Serial,
+    Colored,
+    Vertex,
+    Chaotic,
+    Adaptive
+};
+
+inline const char *solverName(SolverMode mode)
+{
+    switch (mode)
+    {
+    case SolverMode::Colored:
+        return "colored";
+    case SolverMode::Vertex:
+        return "vertex";
+    case SolverMode::Chaotic:
+        return "chaotic";
+    case SolverMode::Adaptive:
+        return "adaptive";
+    default:
+        return "serial";
+    }
+}
+
+inline bool parseSolverMode(const std::string &name, SolverMode &mode)
+{
+    for (SolverMode m : {SolverMode::Serial, SolverMode::Colored, SolverMode::Vertex, SolverMode::Chaotic,
+                          SolverMode::Adaptive})
+    {
+        if (name == solverName(m))
+        {
+            mode = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * ENUM: TearMode
+ * What happens to the cloth when a link tears.
+ * ------------------------------------------------------------------
+ *
+ * Remove: the link disappears and its endpoints stay shared by the rest
+ *         of the fabric, so tears pull out as threads.
+ * Split:  additionally, the busier endpoint is duplicated and its links
+ *         are shared out between the two copies (see Cloth::splitPoint),
+ *         so the fabric rips open along the tear front.
+ * ------------------------------------------------------------------
+ */
+enum class TearMode
+{
+    Remove,
+    Split
+};
+
+inline const char *tearModeName(TearMode mode)
+{
+    switch (mode)
+    {
+    case TearMode::Split:
+        return "split";
+    default:
+        return "remove";
+    }
+}
+
+inline bool parseTearMode(const std::string &name, TearMode &mode)
+{
+    for (TearMode m : {TearMode::Remove, TearMode::Split})
+    {
+        if (name == tearModeName(m))
+        {
+            mode = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * ENUM: PinPattern
+ * Which of the topmost points the cloth builders pin.
+ * ------------------------------------------------------------------
+ *
+ * Top:     all of them (the stock look).
+ * Corners: the leftmost and the rightmost.
+ * Spaced:  every Cloth::pinSpacing-th from the left, plus the rightmost.
+ *
+ * PINS:
+ * Pinned points are not flagged on the Point. The cloth keeps a list of
+ * (point, target) pairs and gives each pinned point zero inverse mass,
+ * so the solvers never move it. Before solving and after integration it
+ * writes each target back over its point. The per-point loops therefore
+ * treat every point alike, and animating a pin (or dragging one with the
+ * mouse) is just moving its target.
+ * ------------------------------------------------------------------
+ */
+enum class PinPattern
+{
+    Top,
+    Corners,
+    Spaced
+};
+
+inline const char *pinPatternName(PinPattern pattern)
+{
+    switch (pattern)
+    {
+    case PinPattern::Corners:
+        return "corners";
+    case PinPattern::Spaced:
+        return "spaced";
+    default:
+        return "top";
+    }
+}
+
+inline bool parsePinPattern(const std::string &name, PinPattern &pattern)
+{
+    for (PinPattern p : {PinPattern::Top, PinPattern::Corners, PinPattern::Spaced})
+    {
+        if (name == pinPatternName(p))
+        {
+            pattern = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct Pin
+{
+    uint32_t point;      // Index into Cloth::points
+    sf::Vector3f target; // Where the point is held
+    float invMass;       // The point's own inverse mass, given back by unpin()
+};
+
+/**
+ * ------------------------------------------------------------------
+ * STRUCT: AnchorTrack
+ * Keyframed motion for a set of pinned points (a curtain rail, a
+ * swaying pole, ...).
+ * ------------------------------------------------------------------
+ *
+ * Keys are offsets from the points' positions when the track was
+ * bound. Cloth::step samples each track once per frame and moves the
+ * pins of its points to rest + offset, so the solver sees animated
+ * anchors exactly like static pins.
+ *
+ *   offset ^        key1
+ *          |       /    \         linear: straight segments
+ *          |  key0       key2     smooth: Catmull-Rom through the keys
+ *          +-------------------> time (looped: wraps at the last key)
+ * ------------------------------------------------------------------
+ */
+struct Keyframe
+{
+    float time; // Seconds
+    sf::Vector3f offset;
+};
+
+struct AnchorTrack
+{
+    std::vector<Keyframe> keys;       // Sorted by time
+    std::vector<uint32_t> points;     // Driven points
+    std::vector<sf::Vector3f> rest;   // Their positions when bound
+    bool smooth = false;
+    bool loop = true;
+
+    sf::Vector3f sample(double t) const
+    {
+        if (keys.empty())
+            return {};
+        float end = keys.back().time;
+        if (loop && end > 0.f)
+            t = std::fmod(t, static_cast<double>(end));
+        if (t <= keys.front().time)
+            return keys.front().offset;
+        if (t >= end)
+            return keys.back().offset;
+
+        size_t k = std::upper_bound(keys.begin(), keys.end(), t, [](double time, const Keyframe &key)
+                                    { return time < key.time; }) -
+                   keys.begin() - 1;
+        const Keyframe &a = keys[k], &b = keys[k + 1];
+        float u = static_cast<float>((t - a.time) / (b.time - a.time));
+        if (!smooth)
+            return a.offset + (b.offset - a.offset) * u;
+
+        // Catmull-Rom, repeating the end keys
+        sf::Vector3f p0 = keys[k > 0 ? k - 1 : k].offset;
+        sf::Vector3f p3 = keys[k + 2 < keys.size() ? k + 2 : k + 1].offset;
+        float u2 = u * u, u3 = u2 * u;
+        return (a.offset * 2.f + (b.offset - p0) * u + (p0 * 2.f - a.offset * 5.f + b.offset * 4.f - p3) * u2 +
+                (a.offset * 3.f - p0 - b.offset * 3.f + p3) * u3) *
+               0.5f;
+    }
+};
+
+/**
+ * ------------------------------------------------------------------
+ * STRUCT: SimParams
+ * The tunable knobs of one simulation. Defaults are the constants
+ * above, so a default-constructed SimParams is the stock look.
+ * ------------------------------------------------------------------
+ */
+struct SimParams
+{
+    float gravity = GRAVITY;
+    float airFriction = AIR_FRICTION;
+    float stretchLimit = STRETCH_LIMIT;
+    int iterations = ITERATIONS;
+    int substeps = SUBSTEPS;
+    float wind = WIND;
+    float zDamping = Z_DAMPING;
+    SolverMode solver = SolverMode::Serial;
+    TearMode tear = TearMode::Remove;
+    float tileThreshold = TILE_THRESHOLD; // Adaptive solver only
+    float drag = 0.f;                     // Aerodynamic coefficients (0 = no aerodynamics pass)
+    float lift = 0.f;
+    sf::Vector3f air;                     // Air velocity, px per frame
+    float strainMin = 0.f;                // Strain-limiting band, in rest lengths (strainMax 0 = off)
+    float strainMax = 0.f;
+
+    // The parameters of one of `substeps` equal slices of a frame. Verlet
+    // velocities are per step, so a step of 1/n frame scales the
+    // accelerations (gravity, wind) by 1/n^2 and the per-step dampings
+    // by their n-th root: n substeps fall the same distance per frame
+    // and lose the same speed per frame as one full step.
+    SimParams substep() const
+    {
+        SimParams p = *this;
+        float n = static_cast<float>(std::max(1, substeps));
+        p.gravity = gravity / (n * n);
+        p.wind = wind / (n * n);
+        p.air = air / n; // Velocities are per step; drag and lift scale with their square
+        p.airFriction = std::pow(airFriction, 1.f / n);
+        p.zDamping = std::pow(zDamping, 1.f / n);
+        p.substeps = 1;
+        return p;
+    }
+};
+
+/**
+ * ------------------------------------------------------------------
+ * STRUCT: Point
+ * Represents a single particle in the cloth mesh.
+ * ------------------------------------------------------------------
+ *
+ * VERLET INTEGRATION EXPLAINED:
+ * Instead of storing velocity explicitly, we store the previous position.
+ * Velocity is implicitly derived:
+ *
+ * PrevPos        CurrentPos        NextPos
+ * O ―――――――――――> O ―――――――――――> O
+ * ^                 ^
+ * (Pos - Prev)      Apply this delta
+ * is the vector     to current pos
+ *
+ * ------------------------------------------------------------------
+ */
+struct Point
+{
+    sf::Vector3f pos;     // Current Position (x, y, z)
+    sf::Vector3f prevPos; // Position in the previous frame
+    float invMass = 1.f;  // 1 / mass; 0 while pinned (the solvers never move it)
+
+    Point(float x, float y, float z) : pos(x, y, z), prevPos(x, y, z) {}
+
+    // Pinned points are integrated too; Cloth puts them back afterwards.
+    // Gravity is an acceleration and moves every mass alike; the wind and
+    // `force` (aerodynamics) are forces, so heavy points feel less of them
+    void update(float time, const SimParams &params = SimParams(), sf::Vector3f force = sf::Vector3f())
+    {
+        // 1. Calculate Velocity (Verlet)
+        sf::Vector3f vel = (pos - prevPos) * params.airFriction;
+
+        // 2. Update Positions
+        prevPos = pos;
+        pos += vel;
+        pos.y += params.gravity; // Apply gravity force
+        pos += force * invMass;
+
+        // 3. Simulate Wind (Sine wave on Z-axis)
+        //    Adds a subtle oscillation to make it look alive.
+        pos.z += std::sin(time + pos.x * 0.05f) * params.wind * invMass;
+        pos.z *= params.zDamping; // Damping on Z to prevent infinite oscillation
+    }
+};
+
+// Relaxed atomic access to a position shared between workers (the
+// chaotic solver). Per component: a vector may mix two writers' values.
+inline sf::Vector3f relaxedLoad(const sf::Vector3f &v)
+{
+    sf::Vector3f r;
+#if defined(__GNUC__)
+    __atomic_load(&v.x, &r.x, __ATOMIC_RELAXED);
+    __atomic_load(&v.y, &r.y, __ATOMIC_RELAXED);
+    __atomic_load(&v.z, &r.z, __ATOMIC_RELAXED);
+#else
+    r = v;
+#endif
+    return r;
+}
+
+inline void relaxedStore(sf::Vector3f &v, sf::Vector3f value)
+{
+#if defined(__GNUC__)
+    __atomic_store(&v.x, &value.x, __ATOMIC_RELAXED);
+    __atomic_store(&v.y, &value.y, __ATOMIC_RELAXED);
+    __atomic_store(&v.z, &value.z, __ATOMIC_RELAXED);
+#else
+    v = value;
+#endif
+}
+
+/**
+ * ------------------------------------------------------------------
+ * FUNCTION: triangleAero
+ * Drag and lift on one cloth triangle.
+ * ------------------------------------------------------------------
+ *
+ * With the triangle's edges e1, e2 (normal n, area A) moving at v
+ * relative to the air (mean corner velocity minus SimParams::air), and
+ * u = v . n its speed along the normal:
+ *
+ *   drag  = -drag * A * |u| * v                        |v|^2 |cos|, against v
+ *   lift  = -lift * A * u * |v| * (n - v u / |v|^2)     |v|^2 cos sin, across v
+ *
+ * A face-on triangle gets full drag and no lift, an edge-on one neither.
+ * Branch-free (degenerate triangles and still air give zero), so the
+ * grid's per-row loops vectorize.
+ * ------------------------------------------------------------------
+ */
+inline sf::Vector3f triangleAero(sf::Vector3f e1, sf::Vector3f e2, sf::Vector3f v, float drag, float lift)
+{
+    sf::Vector3f cross(e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x);
+    float twiceArea = std::sqrt(cross.x * cross.x + cross.y * cross.y + cross.z * cross.z);
+    sf::Vector3f n = cross / std::max(twiceArea, 1e-12f);
+    float area = 0.5f * twiceArea;
+    float u = v.x * n.x + v.y * n.y + v.z * n.z;
+    float speed2 = v.x * v.x + v.y * v.y + v.z * v.z;
+    float speed = std::sqrt(speed2);
+    sf::Vector3f across = n - v * (u / std::max(speed2, 1e-12f));
+    return v * (-drag * area * std::fabs(u)) + across * (-lift * area * u * speed);
+}
+
+/**
+ * ------------------------------------------------------------------
+ * STRUCT: Link
+ * Represents the constraint (stick) between two points.
+ * ------------------------------------------------------------------
+ *
+ * CONSTRAINT SOLVING:
+ * We want the distance (d) between P1 and P2 to always equal targetDist.
+ * If (d != targetDist), we push/pull P1 and P2 to fix it.
+ *
+ * P1 <---- (correction) ----> P2
+ *
+ * ------------------------------------------------------------------
+ */
+struct Link
+{
+    Point *p1;
+    Point *p2;
+    float targetDist;    // The resting length of the link
+    bool broken = false; // True if the link has been cut or snapped
+    uint8_t color = 0;   // Batch of the coloured solver (no shared points within a colour)
+
+    Link(Point &a, Point &b) : p1(&a), p2(&b)
+    {
+        sf::Vector3f d = p1->pos - p2->pos;
+        targetDist = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+    }
+
+    // Returns the relative stretch error |dist - targetDist| / targetDist
+    // seen before the correction: 0 for links that were already broken,
+    // and LINK_SNAPPED (negative) if this call tore the link.
+    float solve(float stretchLimit = STRETCH_LIMIT)
+    {
+        if (broken)
+            return 0.f;
+
+        sf::Vector3f diff = p1->pos - p2->pos;
+        float dist = std::sqrt(diff.x * diff.x + diff.y * diff.y + diff.z * diff.z);
+
+        // --- TEAR LOGIC ---
+        // If stretched too far (5x length), the link snaps.
+        if (dist > targetDist * stretchLimit)
+        {
+            broken = true;
+            return LINK_SNAPPED;
+        }
+
+        // Avoid division by zero
+        if (dist < 0.1f)
+            return 1.f;
+
+        // Calculate the correction factor
+        // (Difference between current dist and target dist), shared out
+        // by inverse mass: half each for equal masses, all of it to the
+        // free end next to a pin, nothing if both are pinned
+        float w1 = p1->invMass, w2 = p2->invMass;
+        float factor = (targetDist - dist) / (dist * std::max(w1 + w2, 1e-6f));
+
+        // Apply correction
+        p1->pos += diff * (factor * w1);
+        p2->pos -= diff * (factor * w2);
+
+        return std::fabs(targetDist - dist) / targetDist;
+    }
+
+    // Strain limiting: if the link is shorter than lo or longer than hi
+    // times targetDist, moves its ends (shared by inverse mass) to the
+    // nearer bound. Links inside the band, nearly all of them, return
+    // after one squared length, with no square root.
+    void limit(float lo, float hi)
+    {
+        sf::Vector3f diff = p1->pos - p2->pos;
+        float d2 = diff.x * diff.x + diff.y * diff.y + diff.z * diff.z;
+        float shortest = targetDist * lo, longest = targetDist * hi;
+        if (broken || (d2 >= shortest * shortest && d2 <= longest * longest) || d2 < 1e-12f)
+            return;
+
+        float dist = std::sqrt(d2);
+        float bound = dist > longest ? longest : shortest;
+        float w1 = p1->invMass, w2 = p2->invMass;
+        float factor = (bound - dist) / (dist * std::max(w1 + w2, 1e-6f));
+        p1->pos += diff * (factor * w1);
+        p2->pos -= diff * (factor * w2);
+    }
+};
+
+/**
+ * ------------------------------------------------------------------
+ * TOPOLOGY EVENTS
+ * ------------------------------------------------------------------
+ *
+ * Every link that breaks (snapped by the solver or cut by the user) is
+ * recorded as a TearEvent. Compaction then removes exactly those links,
+ * filling each hole with a link from the end of its colour batch and
+ * sliding later batches down by moving only their tail links:
+ *
+ *   before:  [a a X a a | b b b X | c c c]      X = torn
+ *   holes:   [a a a a _ | b b b _ | c c c]      (tail link moved into hole)
+ *   slide:   [a a a a | b b b | c c c]          (b moves 1, c moves 2)
+ *
+ * so a tear costs O(colours), not O(links), and the array stays dense.
+ * Each removal and each move is announced to the TopologyListeners, so
+ * anything indexed by link (adjacency, tiles, ...) updates in place.
+ * ------------------------------------------------------------------
+ */
+struct TearEvent
+{
+    uint32_t link;   // Index of the link when it broke
+    uint32_t p1, p2; // Its endpoints (point indices)
+};
+
+struct TopologyListener
+{
+    virtual ~TopologyListener() = default;
+    virtual void linkRemoved(const TearEvent &) {}         // Called before any slot is reused
+    virtual void linkMoved(uint32_t /*from*/, uint32_t /*to*/) {}
+    virtual void pointSplit(uint32_t /*from*/, uint32_t /*clone*/) {} // `clone` took some of `from`'s links
+    virtual void topologyRebuilt() {}                      // Links were rebuilt or reordered wholesale
+};
+
+/**
+ * ------------------------------------------------------------------
+ * STRUCT: Cloth
+ * Owns the particles and constraints of one simulation.
+ * ------------------------------------------------------------------
+ *
+ * The vectors are cleared, never shrunk, between builds: rebuilding a
+ * cloth of the same size reuses the same memory, and because `points`
+ * is reserved up front the Link pointers into it stay valid. Both big
+ * arrays use the page-aware allocator (see memory.hpp) and are first
+ * touched by the workers that solve them.
+ * ------------------------------------------------------------------
+ */
+struct Cloth
+{
+    PageVector<Point> points;
+    PageVector<Link> links;
+    double residual = 0.0; // Mean relative stretch error of the intact links in the last solver pass
+
+    // Parallel modes run on this pool (nullptr = everything on the caller).
+    WorkerPool *pool = nullptr;
+
+    // Coloured solver: once `colorSorted`, links are ordered by colour and
+    // colour c occupies [batchEnd[c - 1], batchEnd[c]) (batchEnd[-1] = 0).
+    bool colorSorted = false;
+    std::vector<size_t> batchEnd;
+    // False if the links' colours are not a valid colouring (a mesh whose
+    // colouring failed): the colored solver then runs serially.
+    bool colorValid = true;
+
+    // CSR particle -> link adjacency: the links touching point i are
+    // adjLinks[adjOffset[i] .. adjEnd[i]). Segments are sized at build time
+    // and shrink in place as links are removed; a split point hands the
+    // back of its segment to its clone. Built on demand by
+    // buildAdjacency(); empty until then.
+    std::vector<uint32_t> adjOffset;
+    std::vector<uint32_t> adjEnd;
+    std::vector<uint32_t> adjLinks;
+
+    // Vertex solver: points ordered by a colouring in which no two linked
+    // points share a colour; colour c is vertexOrder[vertexBatchEnd[c - 1]
+    // .. vertexBatchEnd[c]). Removing links keeps it valid; new points
+    // (splits) trigger a recolouring. Built on demand by colorVertices().
+    std::vector<uint32_t> vertexOrder;
+    std::vector<size_t> vertexBatchEnd;
+
+    // Adaptive solver: links grouped into tiles by the TILE_POINTS cell
+    // their first point was in when the tiles were built. Tile t is
+    // tileLinks[tileOffset[t] .. tileEnd[t]); link l sits in tile
+    // tileOf[l] at tileLinks[tileSlot[l]]. tileError[t] is the summed
+    // error of its last pass. Like the adjacency, segments shrink in place
+    // as links are removed and entries follow moved links, so a tear
+    // costs only its own tile; a colour re-sort renumbers the entries.
+    std::vector<uint32_t> tileOffset;
+    std::vector<uint32_t> tileEnd;
+    std::vector<uint32_t> tileLinks;
+    std::vector<uint32_t> tileOf;
+    std::vector<uint32_t> tileSlot;
+    std::vector<double> tileError;
+    std::vector<uint32_t> tileQueue; // Tiles still over the threshold
+    size_t tilePasses = 0; // Extra tile passes the adaptive solver made in the last step
+
+    // Triangles (three point indices each) from the builders, for the
+    // aerodynamics pass. triAlive[t] is 0 once a link between two of its
+    // corners is removed. triOffset/triOfPoint is the point -> triangle CSR,
+    // and triForce[t] each corner's share of triangle t's force. Built on
+    // demand by buildAero(); points split off later get no share.
+    std::vector<uint32_t> triangles;
+    std::vector<float> triAlive;
+    std::vector<uint32_t> triOffset;
+    std::vector<uint32_t> triOfPoint;
+    std::vector<sf::Vector3f> triForce;
+
+    // Links broken since the last compaction, and the ones the last
+    // step() removed (valid until the next step()).
+    std::vector<TearEvent> pendingTears;
+    std::vector<TearEvent> frameTears;
+
+    // Notified of every link removal and move (not owned).
+    std::vector<TopologyListener *> listeners;
+
+    // Spare point slots the builders reserve for TearMode::Split, as a
+    // fraction of the points built. Splitting only ever fills this
+    // reserved capacity, so `points` never reallocates and Link pointers
+    // stay valid; once it is used up, tears fall back to plain removal.
+    float splitReserve = 0.f;
+
+    // Pinned points (see PINS). The builders pin the topmost points
+    // chosen by `pinPattern`.
+    std::vector<Pin> pins;
+    PinPattern pinPattern = PinPattern::Top;
+    int pinSpacing = PIN_SPACING;
+
+    // pins[pinSlot[i]] is point i's pin, if that entry names point i
+    // (a sparse set: no clearing, O(1) pin/unpin/lookup).
+    std::vector<uint32_t> pinSlot;
+
+    // Keyframed anchors, sampled at `simTime` (FRAME_TIME per step) at the
+    // start of every step. Bind points with bindTrack().
+    std::vector<AnchorTrack> anchors;
+    double simTime = 0.0;
+
+    // Drops all particles, links and derived data, keeping the memory.
+    void clear()
+    {
+        points.clear();
+        links.clear();
+        colorSorted = false;
+        batchEnd.clear();
+        colorValid = true;
+        adjOffset.clear();
+        adjEnd.clear();
+        adjLinks.clear();
+        vertexOrder.clear();
+        vertexBatchEnd.clear();
+        tileOffset.clear();
+        triangles.clear();
+        triOffset.clear();
+        pendingTears.clear();
+        frameTears.clear();
+        pins.clear();
+        anchors.clear();
+        simTime = 0.0;
+        notifyRebuilt();
+    }
+
+    // Pins `point` to `target`, or moves its pin there if it has one.
+    void pin(uint32_t point, sf::Vector3f target)
+    {
+        size_t slot = pinIndex(point);
+        if (slot < pins.size())
+        {
+            pins[slot].target = target;
+            return;
+        }
+        if (pinSlot.size() <= point)
+            pinSlot.resize(points.capacity());
+        pinSlot[point] = static_cast<uint32_t>(pins.size());
+        pins.push_back({point, target, points[point].invMass});
+        points[point].invMass = 0.f;
+    }
+
+    void pin(uint32_t point) { pin(point, points[point].pos); }
+
+    void unpin(uint32_t point)
+    {
+        size_t slot = pinIndex(point);
+        if (slot == pins.size())
+            return;
+        points[point].invMass = pins[slot].invMass;
+        pins[slot] = pins.back();
+        pinSlot[pins[slot].point] = static_cast<uint32_t>(slot);
+        pins.pop_back();
+    }
+
+    bool isPinned(uint32_t point) const { return pinIndex(point) < pins.size(); }
+
+    // Sets a point's mass (a pinned point gets it back when unpinned).
+    void setMass(uint32_t point, float mass)
+    {
+        float invMass = mass > 0.f ? 1.f / mass : 0.f;
+        size_t slot = pinIndex(point);
+        (slot < pins.size() ? pins[slot].invMass : points[point].invMass) = invMass;
+    }
+
+    // Mass of the points within half a rest length of the lowest point
+    // (the bottom row of the grid): a weighted hem.
+    void setHemMass(float mass)
+    {
+        if (points.empty())
+            return;
+        float bottom = points[0].pos.y;
+        for (const Point &p : points)
+            bottom = std::max(bottom, p.pos.y);
+        float band = (links.empty() ? DISTANCE : links[0].targetDist) * 0.5f;
+        for (size_t i = 0; i < points.size(); i++)
+            if (points[i].pos.y > bottom - band)
+                setMass(static_cast<uint32_t>(i), mass);
+    }
+
+    // Makes `track` drive `points` (pinning them) from their current positions.
+    void bindTrack(AnchorTrack track)
+    {
+        track.rest.clear();
+        for (uint32_t p : track.points)
+            track.rest.push_back(points[p].pos);
+        anchors.push_back(std::move(track));
+    }
+
+    // Pins the points of `top` (the topmost points, left to right) that
+    // `pinPattern` selects.
+    void pinTop(const std::vector<uint32_t> &top)
+    {
+        for (size_t i = 0; i < top.size(); i++)
+        {
+            bool last = i + 1 == top.size();
+            if (pinPattern == PinPattern::Top || (pinPattern == PinPattern::Corners && (i == 0 || last)) ||
+                (pinPattern == PinPattern::Spaced && (i % std::max(pinSpacing, 1) == 0 || last)))
+                pin(top[i]);
+        }
+    }
+
+    void buildGrid(int width, int height, float spacing = DISTANCE)
+    {
+        clear();
+        points.reserve(static_cast<size_t>(width * height * (1.f + splitReserve)));
+        links.reserve(static_cast<size_t>(width - 1) * height + static_cast<size_t>(height - 1) * width);
+        firstTouch(pool, points.data(), 0, static_cast<size_t>(width) * height); // Split like "integrate"
+
+        // 1. Initialize Points (Grid)
+        //    Loops Y then X to create the mesh
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                // Center the cloth horizontally
+                points.emplace_back(x * spacing - (width * spacing) / 2.f, y * spacing, 0.f);
+            }
+        }
+
+        // Pin (some of) the top row so the cloth hangs
+        std::vector<uint32_t> top(width);
+        for (int x = 0; x < width; x++)
+            top[x] = static_cast<uint32_t>(x);
+        pinTop(top);
+
+        // 2. Initialize Links (Connections)
+        //    Connects right (x+1) and down (y+1)
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                if (x < width - 1) // Link to Right
+                {
+                    links.emplace_back(points[y * width + x], points[y * width + x + 1]);
+                    links.back().color = static_cast<uint8_t>(x % 2);
+                }
+
+                if (y < height - 1) // Link Down
+                {
+                    links.emplace_back(points[y * width + x], points[(y + 1) * width + x]);
+                    links.back().color = static_cast<uint8_t>(2 + y % 2);
+                }
+            }
+        }
+
+        // 3. Two triangles per grid cell (for aerodynamics)
+        triangles.reserve(static_cast<size_t>(width - 1) * (height - 1) * 6);
+        for (int y = 0; y + 1 < height; y++)
+        {
+            for (int x = 0; x + 1 < width; x++)
+            {
+                uint32_t i = static_cast<uint32_t>(y * width + x), w = static_cast<uint32_t>(width);
+                triangles.insert(triangles.end(), {i, i + 1, i + w, i + 1, i + w + 1, i + w});
+            }
+        }
+        notifyRebuilt();
+    }
+
+    // Advances the simulation by one frame. Returns the number of links
+    // that were removed (snapped or cut) this frame; they are listed in
+    // `frameTears`.
+    size_t step(float time, const SimParams &params)
+    {
+        bool vertex = params.solver == SolverMode::Vertex;
+        bool colored = params.solver == SolverMode::Colored && colorValid;
+        bool chaotic = params.solver == SolverMode::Chaotic;
+        bool adaptive = params.solver == SolverMode::Adaptive;
+        if (colored && !colorSorted)
+            sortByColor();
+        if ((params.tear == TearMode::Split || vertex) && adjOffset.empty())
+            buildAdjacency(); // Splitting and the vertex solver walk a point's links
+        if (vertex && vertexOrder.size() != points.size())
+            colorVertices();
+        if (adaptive && tileOffset.empty())
+            buildTiles();
+        bool aero = (params.drag != 0.f || params.lift != 0.f) && !triangles.empty();
+        if (aero && triOffset.empty())
+            buildAero();
+
+        // Move the animated pins (one sample per track)
+        for (const AnchorTrack &track : anchors)
+        {
+            sf::Vector3f offset = track.sample(simTime);
+            for (size_t i = 0; i < track.points.size(); i++)
+                pin(track.points[i], track.rest[i] + offset);
+        }
+        simTime += FRAME_TIME;
+
+        // Each substep solves and then integrates a 1/substeps slice of
+        // the frame; broken links are skipped by the solver until the last
+        // substep removes them
+        const SimParams sub = params.substep();
+        const int substeps = std::max(1, params.substeps);
+        for (int s = 0; s < substeps; s++)
+        {
+            // --- Logic: Physics Solver ---
+            // Iterate multiple times per frame for stability (stiffer cloth)
+            // 1 iteration = rubbery/stretchy
+            // 8 iterations = rigid cloth
+            {
+                TraceScope span("solve");
+                holdPins(false); // Pins are where their targets are; nothing moves them until integration
+                double error = vertex    ? solveVertices(sub)
+                               : colored ? solveColored(sub)
+                               : chaotic  ? solveChaotic(sub)
+                               : adaptive ? solveAdaptive(sub)
+                                          : solveSerial(sub);
+                // Broken links stay in the array until compact() but add no error
+                size_t live = links.size() - pendingTears.size();
+                residual = live == 0 ? 0.0 : error / live;
+            }
+
+            // Remove this frame's broken links (and only those)
+            if (s == substeps - 1)
+            {
+                TraceScope span("compact");
+                compact();
+                if (params.tear == TearMode::Split)
+                    splitTears();
+            }
+
+            if (aero)
+            {
+                TraceScope span("aero");
+                computeAero(sub);
+            }
+
+            // Update individual point physics (gravity, wind, aerodynamics)
+            {
+                TraceScope span("integrate");
+                auto integrate = [&](size_t begin, size_t end, unsigned)
+                {
+                    for (size_t i = begin; i < end; i++)
+                        points[i].update(time, sub, aero ? aeroForce(i) : sf::Vector3f());
+                };
+                if (params.solver != SolverMode::Serial)
+                    forRange("integrate", points.size(), integrate);
+                else if (!points.empty())
+                    integrate(0, points.size(), 0);
+                holdPins(true);
+
+                // Last, so the bound holds for the positions that are drawn
+                if (params.strainMax > 0.f)
+                {
+                    TraceScope span("strain limit");
+                    limitStrain(sub);
+                }
+            }
+        }
+
+        return frameTears.size();
+    }
+
+    // Breaks link `l` (e.g. cut by the user). It is removed at the next compaction.
+    void cut(size_t l)
+    {
+        if (links[l].broken)
+            return;
+        links[l].broken = true;
+        recordTear(l);
+    }
+
+    size_t indexOf(const Point *p) const { return static_cast<size_t>(p - points.data()); }
+
+    // Two counting passes over the links: O(points + links).
+    void buildAdjacency()
+    {
+        adjOffset.assign(points.size() + 1, 0);
+        for (const Link &l : links)
+        {
+            adjOffset[indexOf(l.p1) + 1]++;
+            adjOffset[indexOf(l.p2) + 1]++;
+        }
+        for (size_t i = 0; i < points.size(); i++)
+            adjOffset[i + 1] += adjOffset[i];
+
+        adjLinks.resize(adjOffset.back());
+        adjOffset.pop_back(); // One entry per point, so split points can append theirs
+        adjEnd = adjOffset;
+        for (size_t l = 0; l < links.size(); l++)
+        {
+            adjLinks[adjEnd[indexOf(links[l].p1)]++] = static_cast<uint32_t>(l);
+            adjLinks[adjEnd[indexOf(links[l].p2)]++] = static_cast<uint32_t>(l);
+        }
+    }
+
+    // Buckets the links by the TILE_POINTS x TILE_POINTS cell (in mean
+    // rest lengths) of their first point, row-major from the top, with
+    // empty cells dropped. Counting sort: O(points + links + cells).
+    void buildTiles()
+    {
+        tileOffset.assign(1, 0);
+        tileEnd.clear();
+        tileLinks.clear();
+        if (links.empty())
+            return;
+
+        double rest = 0.0;
+        for (const Link &l : links)
+            rest += l.targetDist;
+        float span = std::max(1.f, static_cast<float>(rest / links.size()) * TILE_POINTS);
+        float minX = links[0].p1->pos.x, minY = links[0].p1->pos.y, maxX = minX, maxY = minY;
+        for (const Link &l : links)
+        {
+            minX = std::min(minX, l.p1->pos.x);
+            maxX = std::max(maxX, l.p1->pos.x);
+            minY = std::min(minY, l.p1->pos.y);
+            maxY = std::max(maxY, l.p1->pos.y);
+        }
+        size_t cols = static_cast<size_t>((maxX - minX) / span) + 1;
+        size_t rows = static_cast<size_t>((maxY - minY) / span) + 1;
+        auto cell = [&](const Link &l)
+        {
+            return static_cast<size_t>((l.p1->pos.y - minY) / span) * cols +
+                   static_cast<size_t>((l.p1->pos.x - minX) / span);
+        };
+
+        std::vector<uint32_t> count(cols * rows + 1, 0);
+        for (const Link &l : links)
+            count[cell(l) + 1]++;
+        for (size_t c = 0; c < cols * rows; c++)
+        {
+            if (count[c + 1] > 0)
+                tileOffset.push_back(tileOffset.back() + count[c + 1]);
+            count[c + 1] += count[c];
+        }
+        tileLinks.resize(links.size());
+        for (size_t l = 0; l < links.size(); l++)
+            tileLinks[count[cell(links[l])]++] = static_cast<uint32_t>(l);
+        tileEnd.assign(tileOffset.begin() + 1, tileOffset.end());
+        tileError.assign(tileOffset.size() - 1, 0.0);
+        indexTiles();
+    }
+
+    // Fills tileOf and tileSlot from the tile segments. O(links).
+    void indexTiles()
+    {
+        tileOf.resize(links.size());
+        tileSlot.resize(links.size());
+        for (uint32_t t = 0; t < tileEnd.size(); t++)
+        {
+            for (uint32_t k = tileOffset[t]; k < tileEnd[t]; k++)
+            {
+                tileOf[tileLinks[k]] = t;
+                tileSlot[tileLinks[k]] = k;
+            }
+        }
+    }
+
+    // Point -> triangle CSR and per-triangle force slots. Every triangle
+    // starts out alive: this runs at the first step with aerodynamics,
+    // and only tears compacted after it are seen (dropTriangles).
+    void buildAero()
+    {
+        size_t count = triangles.size() / 3;
+        triOffset.assign(points.size() + 1, 0);
+        for (uint32_t c : triangles)
+            triOffset[c + 1]++;
+        for (size_t i = 0; i < points.size(); i++)
+            triOffset[i + 1] += triOffset[i];
+        triOfPoint.resize(triangles.size());
+        std::vector<uint32_t> fill(triOffset.begin(), triOffset.end() - 1);
+        for (size_t k = 0; k < triangles.size(); k++)
+            triOfPoint[fill[triangles[k]]++] = static_cast<uint32_t>(k / 3);
+        triForce.assign(count, sf::Vector3f());
+        triAlive.assign(count, 1.f);
+    }
+
+    // Kills the triangles with both a and b as corners (their shared
+    // edge's link was removed).
+    void dropTriangles(uint32_t a, uint32_t b)
+    {
+        if (a + 1 >= triOffset.size())
+            return; // A split-off point: it has no triangles
+        for (uint32_t k = triOffset[a]; k < triOffset[a + 1]; k++)
+        {
+            const uint32_t *c = &triangles[3 * triOfPoint[k]];
+            if (c[0] == b || c[1] == b || c[2] == b)
+                triAlive[triOfPoint[k]] = 0.f;
+        }
+    }
+
+    // Each triangle's drag and lift (triangleAero), a third per corner.
+    void computeAero(const SimParams &params)
+    {
+        forRange("aero", triAlive.size(), [&](size_t begin, size_t end, unsigned)
+                 {
+                     for (size_t t = begin; t < end; t++)
+                     {
+                         const Point &a = points[triangles[3 * t]], &b = points[triangles[3 * t + 1]],
+                                     &c = points[triangles[3 * t + 2]];
+                         sf::Vector3f v = (a.pos - a.prevPos + b.pos - b.prevPos + c.pos - c.prevPos) / 3.f - params.air;
+                         triForce[t] = triangleAero(b.pos - a.pos, c.pos - a.pos, v, params.drag, params.lift) *
+                                       (triAlive[t] / 3.f);
+                     } });
+    }
+
+    // Point i's summed share of its triangles' forces.
+    sf::Vector3f aeroForce(size_t i) const
+    {
+        sf::Vector3f f;
+        if (i + 1 < triOffset.size())
+            for (uint32_t k = triOffset[i]; k < triOffset[i + 1]; k++)
+                f += triForce[triOfPoint[k]];
+        return f;
+    }
+
+    // Orders links by colour with a counting sort (stable, so each batch
+    // keeps the build order). O(links).
+    void sortByColor()
+    {
+        colorSorted = true;
+        if (std::is_sorted(links.begin(), links.end(), [](const Link &a, const Link &b)
+                           { return a.color < b.color; }))
+        {
+            countBatches();
+            return;
+        }
+
+        size_t count[257] = {};
+        for (const Link &l : links)
+            count[l.color + 1]++;
+        for (int k = 0; k < 256; k++)
+            count[k + 1] += count[k];
+
+        // Place each batch's pages with the workers that will solve it
+        PageVector<Link> sorted;
+        sorted.reserve(links.capacity());
+        for (int k = 0; k < 256; k++)
+            firstTouch(pool, sorted.data(), count[k], count[k + 1]);
+
+        std::vector<uint32_t> order(links.size());
+        for (size_t l = 0; l < links.size(); l++)
+            order[count[links[l].color]++] = static_cast<uint32_t>(l);
+
+        for (uint32_t l : order)
+            sorted.push_back(links[l]);
+        links.swap(sorted);
+
+        countBatches();
+        if (!adjOffset.empty())
+            buildAdjacency(); // Link indices changed
+        if (!tileOffset.empty())
+        {
+            // Same tiles, new indices (the old index is now at position n)
+            std::vector<uint32_t> renumber(links.size());
+            for (size_t n = 0; n < order.size(); n++)
+                renumber[order[n]] = static_cast<uint32_t>(n);
+            for (size_t t = 0; t < tileEnd.size(); t++)
+                for (uint32_t k = tileOffset[t]; k < tileEnd[t]; k++)
+                    tileLinks[k] = renumber[tileLinks[k]];
+            indexTiles();
+        }
+
+        // Pending tears refer to the old indices: find them again
+        if (!pendingTears.empty())
+        {
+            pendingTears.clear();
+            for (size_t l = 0; l < links.size(); l++)
+                if (links[l].broken)
+                    recordTear(l);
+        }
+        notifyRebuilt();
+    }
+
+    // Gives colour-sorted link l the colour `color` and moves it into that
+    // batch. One link moves per batch boundary crossed, through the spare
+    // slot past the end (links only shrink after a build, so any tear
+    // leaves one), and each move is announced like compact()'s. Returns
+    // false, changing nothing, if there is no spare slot or tears are
+    // still pending. O(colours).
+    bool moveToBatch(size_t l, uint8_t color)
+    {
+        uint8_t from = links[l].color;
+        if (from == color)
+            return true;
+        if (!colorSorted || color >= batchEnd.size() || links.size() == links.capacity() || !pendingTears.empty())
+            return false;
+
+        size_t spare = links.size();
+        links.push_back(links[l]);
+        if (!tileOffset.empty())
+        {
+            tileOf.resize(links.size());
+            tileSlot.resize(links.size());
+        }
+        moveLink(l, spare);
+
+        size_t hole = l;
+        if (from < color)
+        {
+            // Each batch in between hands its last slot to the one above
+            for (size_t b = from; b < color; b++)
+            {
+                size_t last = --batchEnd[b];
+                if (last != hole)
+                    moveLink(last, hole);
+                hole = last;
+            }
+        }
+        else
+        {
+            // ...or its first slot to the one below
+            for (size_t b = from; b > color; b--)
+            {
+                size_t first = batchEnd[b - 1]++;
+                if (first != hole)
+                    moveLink(first, hole);
+                hole = first;
+            }
+        }
+        moveLink(spare, hole);
+        links[hole].color = color;
+        links.pop_back();
+        if (!tileOffset.empty())
+        {
+            tileOf.resize(links.size());
+            tileSlot.resize(links.size());
+        }
+        return true;
+    }
+
+    // Greedy colouring of the points (each takes the smallest colour none
+    // of its linked points has; two on the grid), then a counting sort into
+    // vertexOrder. O(points + links); needs the adjacency.
+    void colorVertices()
+    {
+        const uint32_t none = UINT32_MAX;
+        std::vector<uint32_t> color(points.size(), none);
+        std::vector<uint32_t> takenBy; // takenBy[c] == v: a neighbour of v has colour c
+        uint32_t colors = 0;
+        for (uint32_t v = 0; v < points.size(); v++)
+        {
+            for (uint32_t k = adjOffset[v]; k < adjEnd[v]; k++)
+            {
+                const Link &l = links[adjLinks[k]];
+                uint32_t c = color[indexOf(l.p1) == v ? indexOf(l.p2) : indexOf(l.p1)];
+                if (c != none)
+                {
+                    if (c >= takenBy.size())
+                        takenBy.resize(c + 1, none);
+                    takenBy[c] = v;
+                }
+            }
+            uint32_t c = 0;
+            while (c < takenBy.size() && takenBy[c] == v)
+                c++;
+            color[v] = c;
+            colors = std::max(colors, c + 1);
+        }
+
+        vertexBatchEnd.assign(colors, 0);
+        for (uint32_t c : color)
+            vertexBatchEnd[c]++;
+        for (uint32_t c = 1; c < colors; c++)
+            vertexBatchEnd[c] += vertexBatchEnd[c - 1];
+        vertexOrder.resize(points.size());
+        std::vector<size_t> fill(colors, 0);
+        for (uint32_t c = 1; c < colors; c++)
+            fill[c] = vertexBatchEnd[c - 1];
+        for (uint32_t v = 0; v < points.size(); v++)
+            vertexOrder[fill[color[v]]++] = v;
+    }
+
+    // Duplicates point `v` along the tear front of a link that pulled it
+    // towards `torn` (the direction to the link's other endpoint). The
+    // link most across that direction picks the side: every link leaning
+    // the same way moves to the clone, the rest stay. Returns false (and
+    // changes nothing) if there is no spare slot or only one side has
+    // links. O(degree of v); needs the adjacency.
+    bool splitPoint(uint32_t v, sf::Vector3f torn)
+    {
+        uint32_t begin = adjOffset[v], end = adjEnd[v];
+        float len2 = torn.x * torn.x + torn.y * torn.y + torn.z * torn.z;
+        if (end - begin < 2 || points.size() == points.capacity() || len2 < 1e-12f)
+            return false;
+
+        auto offset = [&](uint32_t l)
+        {
+            const Link &link = links[l];
+            return (link.p1 == &points[v] ? link.p2->pos : link.p1->pos) - points[v].pos;
+        };
+        auto dot = [](sf::Vector3f a, sf::Vector3f b) { return a.x * b.x + a.y * b.y + a.z * b.z; };
+
+        sf::Vector3f across;
+        float best = 0.f;
+        for (uint32_t i = begin; i < end; i++)
+        {
+            sf::Vector3f e = offset(adjLinks[i]);
+            sf::Vector3f perp = e - torn * (dot(e, torn) / len2);
+            if (dot(perp, perp) > best)
+            {
+                best = dot(perp, perp);
+                across = perp;
+            }
+        }
+        if (best == 0.f)
+            return false;
+
+        // Links staying with v go to the front of the segment
+        uint32_t mid = begin;
+        for (uint32_t i = begin; i < end; i++)
+            if (dot(offset(adjLinks[i]), across) <= 0.f)
+                std::swap(adjLinks[i], adjLinks[mid++]);
+        if (mid == begin)
+            return false; // Everything is on one side
+
+        uint32_t clone = static_cast<uint32_t>(points.size());
+        points.push_back(points[v]); // Within capacity: no reallocation (the clone is never pinned)
+        size_t pinned = pinIndex(v);
+        if (pinned < pins.size())
+            points.back().invMass = pins[pinned].invMass;
+        adjOffset.push_back(mid);
+        adjEnd.push_back(end);
+        adjEnd[v] = mid;
+        for (uint32_t i = mid; i < end; i++)
+        {
+            Link &link = links[adjLinks[i]];
+            (link.p1 == &points[v] ? link.p1 : link.p2) = &points[clone];
+        }
+        for (TopologyListener *t : listeners)
+            t->pointSplit(v, clone);
+        return true;
+    }
+
+    // Kinetic energy (from the Verlet velocity) plus gravitational potential,
+    // taking y = 0 (the pinned row) as the reference height. Units are per frame.
+    double energy(const SimParams &params) const
+    {
+        double e = 0.0;
+        for (const auto &p : points)
+        {
+            sf::Vector3f v = p.pos - p.prevPos;
+            e += 0.5 * (v.x * v.x + v.y * v.y + v.z * v.z) - params.gravity * p.pos.y;
+        }
+        return e;
+    }
+
+private:
+    // Runs fn(begin, end, worker) over [0, n), split across the pool if there is one.
+    template <typename F>
+    void forRange(const char *name, size_t n, F &&fn)
+    {
+        if (pool)
+            pool->parallelFor(name, n, fn);
+        else if (n > 0)
+            fn(0, n, 0);
+    }
+
+    // Index of point's pin in `pins`, or pins.size() if it has none.
+    size_t pinIndex(uint32_t point) const
+    {
+        if (point < pinSlot.size() && pinSlot[point] < pins.size() && pins[pinSlot[point]].point == point)
+            return pinSlot[point];
+        return pins.size();
+    }
+
+    // Writes the pin targets over the pinned points. `settle` also zeroes
+    // their velocity (after integration).
+    void holdPins(bool settle)
+    {
+        for (const Pin &p : pins)
+        {
+            points[p.point].pos = p.target;
+            if (settle)
+                points[p.point].prevPos = p.target;
+        }
+    }
+
+    void recordTear(size_t l)
+    {
+        pendingTears.push_back({static_cast<uint32_t>(l), static_cast<uint32_t>(indexOf(links[l].p1)),
+                                static_cast<uint32_t>(indexOf(links[l].p2))});
+    }
+
+    // One Link::limit pass after integration: by colour in parallel once
+    // the links are colour-sorted, otherwise in order on this thread.
+    void limitStrain(const SimParams &params)
+    {
+        const float lo = params.strainMin, hi = params.strainMax;
+        if (!colorSorted || !colorValid)
+        {
+            for (Link &l : links)
+                l.limit(lo, hi);
+            return;
+        }
+        size_t begin = 0;
+        for (size_t end : batchEnd)
+        {
+            forRange("strain limit", end - begin, [&](size_t first, size_t last, unsigned)
+                     {
+                         for (size_t l = begin + first; l < begin + last; l++)
+                             links[l].limit(lo, hi); });
+            begin = end;
+        }
+    }
+
+    // Returns the summed relative error of the last pass.
+    double solveSerial(const SimParams &params)
+    {
+        double error = 0.0;
+        for (int i = 0; i < params.iterations; i++)
+        {
+            // Only the last pass's error is reported: it measures how far
+            // the cloth is from its rest shape after solving
+            error = 0.0;
+            for (size_t l = 0; l < links.size(); l++)
+            {
+                float e = links[l].solve(params.stretchLimit);
+                if (e == LINK_SNAPPED)
+                    recordTear(l);
+                else
+                    error += e;
+            }
+        }
+        return error;
+    }
+
+    double solveColored(const SimParams &params)
+    {
+        unsigned workers = pool ? pool->size() : 1;
+        std::vector<double> partial(workers, 0.0);
+        std::vector<std::vector<size_t>> snapped(workers);
+        for (int i = 0; i < params.iterations; i++)
+        {
+            bool last = i == params.iterations - 1;
+            size_t begin = 0;
+            for (size_t end : batchEnd)
+            {
+                forRange("solve batch", end - begin, [&](size_t lo, size_t hi, unsigned w)
+                         {
+                             double error = 0.0;
+                             for (size_t l = begin + lo; l < begin + hi; l++)
+                             {
+                                 float e = links[l].solve(params.stretchLimit);
+                                 if (e == LINK_SNAPPED)
+                                     snapped[w].push_back(l);
+                                 else
+                                     error += e;
+                             }
+                             if (last)
+                                 partial[w] += error; });
+                begin = end;
+            }
+        }
+
+        double error = 0.0;
+        for (unsigned w = 0; w < workers; w++)
+        {
+            error += partial[w];
+            for (size_t l : snapped[w])
+                recordTear(l);
+        }
+        return error;
+    }
+
+    // One vertex colour at a time, its points in parallel (solveVertex).
+    // Linked points are never in the same colour, so each link is seen,
+    // and can snap, from one side at a time.
+    double solveVertices(const SimParams &params)
+    {
+        unsigned workers = pool ? pool->size() : 1;
+        std::vector<double> partial(workers, 0.0);
+        std::vector<std::vector<size_t>> snapped(workers);
+        for (int i = 0; i < params.iterations; i++)
+        {
+            bool last = i == params.iterations - 1;
+            size_t begin = 0;
+            for (size_t end : vertexBatchEnd)
+            {
+                forRange("solve batch", end - begin, [&](size_t lo, size_t hi, unsigned w)
+                         {
+                             double error = 0.0;
+                             for (size_t k = begin + lo; k < begin + hi; k++)
+                                 error += solveVertex(vertexOrder[k], params.stretchLimit, snapped[w]);
+                             if (last)
+                                 partial[w] += error; });
+                begin = end;
+            }
+        }
+
+        double error = 0.0;
+        for (unsigned w = 0; w < workers; w++)
+        {
+            error += partial[w];
+            for (size_t l : snapped[w])
+                recordTear(l);
+        }
+        return error;
+    }
+
+    // Every worker runs all the iterations over its static share of the
+    // links (solveRelaxed), without waiting for the others; the pins are
+    // put back once everyone is done.
+    double solveChaotic(const SimParams &params)
+    {
+        unsigned workers = pool ? pool->size() : 1;
+        std::vector<double> partial(workers, 0.0);
+        std::vector<std::vector<size_t>> snapped(workers);
+        forRange("solve chaotic", links.size(), [&](size_t begin, size_t end, unsigned w)
+                 {
+                     for (int i = 0; i < params.iterations; i++)
+                     {
+                         double error = 0.0;
+                         for (size_t l = begin; l < end; l++)
+                         {
+                             float e = solveRelaxed(links[l], params.stretchLimit);
+                             if (e == LINK_SNAPPED)
+                                 snapped[w].push_back(l);
+                             else
+                                 error += e;
+                         }
+                         partial[w] = error; // This worker's last pass
+                     } });
+
+        double error = 0.0;
+        for (unsigned w = 0; w < workers; w++)
+        {
+            error += partial[w];
+            for (size_t l : snapped[w])
+                recordTear(l);
+        }
+        return error;
+    }
+
+    // Link::solve for the chaotic solver. The endpoints may be moved by
+    // another worker meanwhile, so they are read and written with relaxed
+    // atomics (a read-modify-write race can lose one of the two
+    // corrections, never tear a float). Only this worker touches
+    // l.broken.
+    float solveRelaxed(Link &l, float stretchLimit)
+    {
+        if (l.broken)
+            return 0.f;
+
+        sf::Vector3f a = relaxedLoad(l.p1->pos), b = relaxedLoad(l.p2->pos);
+        sf::Vector3f diff = a - b;
+        float dist = std::sqrt(diff.x * diff.x + diff.y * diff.y + diff.z * diff.z);
+        if (dist > l.targetDist * stretchLimit)
+        {
+            l.broken = true;
+            return LINK_SNAPPED;
+        }
+        if (dist < 0.1f)
+            return 1.f;
+
+        float w1 = l.p1->invMass, w2 = l.p2->invMass;
+        float factor = (l.targetDist - dist) / (dist * std::max(w1 + w2, 1e-6f));
+        relaxedStore(l.p1->pos, a + diff * (factor * w1));
+        relaxedStore(l.p2->pos, b - diff * (factor * w2));
+        return std::fabs(l.targetDist - dist) / l.targetDist;
+    }
+
+    // One pass over every tile (plain Link::solve, as solveSerial), then
+    // up to iterations - 1 rounds over the tiles whose mean error is still
+    // above the threshold, in tile order (top to bottom, like the serial
+    // sweep, so support from the pins still reaches the tiles below in
+    // one round). A tile drops out once it is under the threshold; its
+    // neighbours are re-measured by the next step's first pass.
+    double solveAdaptive(const SimParams &params)
+    {
+        size_t tiles = tileEnd.size();
+        for (size_t t = 0; t < tiles; t++)
+            tileError[t] = solveTile(t, params.stretchLimit);
+
+        auto hot = [&](size_t t)
+        { return tileError[t] > params.tileThreshold * (tileEnd[t] - tileOffset[t]); };
+        tileQueue.clear();
+        for (size_t t = 0; t < tiles; t++)
+            if (hot(t))
+                tileQueue.push_back(static_cast<uint32_t>(t));
+
+        tilePasses = 0;
+        for (int i = 1; i < params.iterations && !tileQueue.empty(); i++)
+        {
+            size_t kept = 0;
+            for (uint32_t t : tileQueue)
+            {
+                tileError[t] = solveTile(t, params.stretchLimit);
+                if (hot(t))
+                    tileQueue[kept++] = t;
+            }
+            tilePasses += tileQueue.size();
+            tileQueue.resize(kept);
+        }
+
+        double error = 0.0;
+        for (double e : tileError)
+            error += e;
+        return error;
+    }
+
+    // One pass over tile t's links; returns their summed error.
+    double solveTile(size_t t, float stretchLimit)
+    {
+        double error = 0.0;
+        for (uint32_t k = tileOffset[t]; k < tileEnd[t]; k++)
+        {
+            float e = links[tileLinks[k]].solve(stretchLimit);
+            if (e == LINK_SNAPPED)
+                recordTear(tileLinks[k]);
+            else
+                error += e;
+        }
+        return error;
+    }
+
+    // Block descent on point v: one Newton step on
+    //   E(p) = 1/2 sum over v's live links of (|p - q| - rest)^2
+    // with the other ends q held still. Each link adds the gradient
+    // (d - rest) n and the Hessian n n^T + max(0, 1 - rest / d)(I - n n^T)
+    // (clamped so compressed links stay positive semi-definite), and the
+    // point moves by -H^-1 g. A link pulls only along its own direction,
+    // so on the grid the two x links settle x and the two y links y,
+    // rather than all four being averaged together. The step is scaled by
+    // 2 w / (w + mean w of the other ends), at most 1, with w the inverse
+    // masses: a heavy point gives way less than its light neighbours.
+    // Returns the relative stretch error of v's live links, counted at
+    // each link's p1 (pinned or not) so the total matches Link::solve's.
+    double solveVertex(uint32_t v, float stretchLimit, std::vector<size_t> &snapped)
+    {
+        Point &p = points[v];
+        float gx = 0.f, gy = 0.f, gz = 0.f;
+        float hxx = 1e-4f, hyy = 1e-4f, hzz = 1e-4f, hxy = 0.f, hxz = 0.f, hyz = 0.f; // Regularised
+        float others = 0.f; // Summed inverse mass of the other ends
+        int count = 0;
+        double error = 0.0;
+        for (uint32_t k = adjOffset[v]; k < adjEnd[v]; k++)
+        {
+            Link &l = links[adjLinks[k]];
+            if (l.broken)
+                continue;
+            bool first = l.p1 == &p;
+            const Point &q = *(first ? l.p2 : l.p1);
+            sf::Vector3f diff = p.pos - q.pos;
+            float dist = std::sqrt(diff.x * diff.x + diff.y * diff.y + diff.z * diff.z);
+            if (dist > l.targetDist * stretchLimit)
+            {
+                l.broken = true;
+                snapped.push_back(adjLinks[k]);
+                continue;
+            }
+            if (dist < 0.1f)
+            {
+                error += first ? 1.0 : 0.0;
+                continue;
+            }
+            if (first)
+                error += std::fabs(l.targetDist - dist) / l.targetDist;
+
+            others += q.invMass;
+            count++;
+            float invDist = 1.f / dist;
+            sf::Vector3f n = diff * invDist;
+            float stretch = dist - l.targetDist;
+            float side = std::max(0.f, stretch * invDist); // 1 - rest / d
+            gx += stretch * n.x;
+            gy += stretch * n.y;
+            gz += stretch * n.z;
+            hxx += side + (1.f - side) * n.x * n.x;
+            hyy += side + (1.f - side) * n.y * n.y;
+            hzz += side + (1.f - side) * n.z * n.z;
+            hxy += (1.f - side) * n.x * n.y;
+            hxz += (1.f - side) * n.x * n.z;
+            hyz += (1.f - side) * n.y * n.z;
+        }
+        if (p.invMass == 0.f)
+            return error; // Pinned: its links are counted, but it does not move
+
+        // p -= H^-1 g (symmetric 3x3, by cofactors)
+        float cxx = hyy * hzz - hyz * hyz, cxy = hxz * hyz - hxy * hzz, cxz = hxy * hyz - hxz * hyy;
+        float det = hxx * cxx + hxy * cxy + hxz * cxz;
+        if (det <= 1e-12f)
+            return error;
+        float cyy = hxx * hzz - hxz * hxz, cyz = hxy * hxz - hxx * hyz, czz = hxx * hyy - hxy * hxy;
+        float share = count ? std::min(1.f, 2.f * p.invMass / (p.invMass + others / count)) : 1.f;
+        float inv = share / det;
+        p.pos.x -= (cxx * gx + cxy * gy + cxz * gz) * inv;
+        p.pos.y -= (cxy * gx + cyy * gy + cyz * gz) * inv;
+        p.pos.z -= (cxz * gx + cyz * gy + czz * gz) * inv;
+        return error;
+    }
+
+    void countBatches()
+    {
+        batchEnd.clear();
+        for (size_t l = 0; l < links.size(); l++)
+        {
+            // Close every colour below this link's colour
+            while (batchEnd.size() < links[l].color)
+                batchEnd.push_back(l);
+        }
+        batchEnd.push_back(links.size());
+    }
+
+    void notifyRebuilt()
+    {
+        for (TopologyListener *t : listeners)
+            t->topologyRebuilt();
+    }
+
+    // Drops link `l` from a point's adjacency segment (swap with the last live entry).
+    void unlinkFrom(uint32_t point, uint32_t l)
+    {
+        uint32_t last = --adjEnd[point];
+        for (uint32_t i = adjOffset[point]; i <= last; i++)
+        {
+            if (adjLinks[i] == l)
+            {
+                adjLinks[i] = adjLinks[last];
+                return;
+            }
+        }
+    }
+
+    // Drops link `l` from its tile, keeping the rest of the tile in order
+    // (the solve order within a tile is top to bottom). O(tile size).
+    void untile(uint32_t l)
+    {
+        uint32_t t = tileOf[l];
+        uint32_t last = --tileEnd[t];
+        for (uint32_t k = tileSlot[l]; k < last; k++)
+        {
+            tileLinks[k] = tileLinks[k + 1];
+            tileSlot[tileLinks[k]] = k;
+        }
+    }
+
+    void relink(uint32_t point, uint32_t from, uint32_t to)
+    {
+        for (uint32_t i = adjOffset[point]; i < adjEnd[point]; i++)
+        {
+            if (adjLinks[i] == from)
+            {
+                adjLinks[i] = to;
+                return;
+            }
+        }
+    }
+
+    void moveLink(size_t from, size_t to)
+    {
+        links[to] = links[from];
+        if (!adjOffset.empty())
+        {
+            relink(static_cast<uint32_t>(indexOf(links[to].p1)), static_cast<uint32_t>(from), static_cast<uint32_t>(to));
+            relink(static_cast<uint32_t>(indexOf(links[to].p2)), static_cast<uint32_t>(from), static_cast<uint32_t>(to));
+        }
+        if (!tileOffset.empty())
+        {
+            tileOf[to] = tileOf[from];
+            tileSlot[to] = tileSlot[from];
+            tileLinks[tileSlot[to]] = static_cast<uint32_t>(to);
+        }
+        for (TopologyListener *t : listeners)
+            t->linkMoved(static_cast<uint32_t>(from), static_cast<uint32_t>(to));
+    }
+
+    // Splits the busier endpoint of each link removed this frame.
+    // Colours stay valid: the clone's links were pairwise distinct at v.
+    void splitTears()
+    {
+        for (const TearEvent &e : frameTears)
+        {
+            uint32_t v = e.p1, other = e.p2;
+            if (adjEnd[e.p2] - adjOffset[e.p2] > adjEnd[e.p1] - adjOffset[e.p1])
+                std::swap(v, other);
+            splitPoint(v, points[other].pos - points[v].pos);
+        }
+    }
+
+    // Removes the links in `pendingTears` as described under TOPOLOGY
+    // EVENTS. O(tears x colours), plus O(tears log tears) to sort them.
+    void compact()
+    {
+        frameTears.swap(pendingTears);
+        pendingTears.clear();
+        if (frameTears.empty())
+            return;
+
+        for (const TearEvent &e : frameTears)
+        {
+            if (!adjOffset.empty())
+            {
+                unlinkFrom(e.p1, e.link);
+                unlinkFrom(e.p2, e.link);
+            }
+            if (!triOffset.empty())
+                dropTriangles(e.p1, e.p2);
+            if (!tileOffset.empty())
+                untile(e.link);
+            for (TopologyListener *t : listeners)
+                t->linkRemoved(e);
+        }
+
+        std::vector<uint32_t> holes(frameTears.size());
+        for (size_t i = 0; i < holes.size(); i++)
+            holes[i] = frameTears[i].link;
+        std::sort(holes.begin(), holes.end());
+
+        std::vector<size_t> ends = colorSorted ? batchEnd : std::vector<size_t>{links.size()};
+        std::vector<size_t> live(ends.size());
+
+        // 1. Within each batch, fill holes with live links from the batch's tail
+        size_t begin = 0, h = 0;
+        for (size_t b = 0; b < ends.size(); b++)
+        {
+            size_t tail = ends[b];
+            size_t removed = 0;
+            for (; h < holes.size() && holes[h] < ends[b]; h++, removed++)
+            {
+                while (tail > begin && links[tail - 1].broken)
+                    tail--;
+                if (holes[h] < tail)
+                    moveLink(--tail, holes[h]);
+            }
+            live[b] = ends[b] - begin - removed;
+            begin = ends[b];
+        }
+
+        // 2. Slide each batch down over the gaps left before it, moving
+        //    only the links that land outside the batch's old range
+        size_t gap = 0;
+        begin = 0;
+        for (size_t b = 0; b < ends.size(); b++)
+        {
+            if (gap > 0)
+            {
+                size_t moves = std::min(gap, live[b]);
+                for (size_t k = 0; k < moves; k++)
+                    moveLink(begin + live[b] - 1 - k, begin - gap + k);
+            }
+            size_t size = ends[b] - begin;
+            gap += size - live[b];
+            begin = ends[b];
+            ends[b] -= gap;
+        }
+
+        links.erase(links.end() - gap, links.end());
+        if (colorSorted)
+            batchEnd = ends;
+        if (!tileOffset.empty())
+        {
+            tileOf.resize(links.size());
+            tileSlot.resize(links.size());
+        }
+    }
+};
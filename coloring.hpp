@@ -0,0 +1,333 @@
+/**
+ * ======================================================================================
+ * EDGE COLOURING (Race-free link batches for any topology)
+ * ======================================================================================
+ *
+ * The coloured solver needs every colour to be a matching: no two links of
+ * one colour may share a point. The grid gets that for free (4 colours by
+ * parity); meshes and edited cloths get it from here.
+ *
+ * colorEdges() is a speculative parallel greedy colouring (Gebremedhin-Manne):
+ *
+ *   round:  every uncoloured edge, in parallel, takes the lowest colour not
+ *           used by any edge around its two endpoints (reads may be stale)
+ *   check:  in parallel, an edge that ended up with the same colour as a
+ *           lower-numbered neighbour edge is put back on the work list
+ *   repeat until the work list is empty (usually 2-3 rounds)
+ *
+ * then a balancing pass moves links out of oversized colours into small ones
+ * where the endpoints allow it, so the parallel batches are similar in size.
+ *
+ * Tears only ever remove links, which keeps a colouring valid but can leave
+ * it lopsided; maintainColors() then moves links near the tears into the
+ * batches that shrank.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include "cloth.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+const uint8_t NO_COLOR = 255;
+const int MAX_COLORS = 64;            // Colours fit one uint64_t mask
+const float COLOR_IMBALANCE = 1.25f;  // Rebalance once a batch exceeds 1.25x the mean
+
+namespace detail
+{
+// Vertex -> edge CSR for an edge list.
+inline void edgeAdjacency(size_t vertexCount, const std::vector<std::pair<uint32_t, uint32_t>> &edges,
+                          std::vector<uint32_t> &offset, std::vector<uint32_t> &adj)
+{
+    offset.assign(vertexCount + 1, 0);
+    for (const auto &e : edges)
+    {
+        offset[e.first + 1]++;
+        offset[e.second + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++)
+        offset[v + 1] += offset[v];
+    adj.resize(offset.back());
+    std::vector<uint32_t> fill(offset.begin(), offset.end() - 1);
+    for (size_t e = 0; e < edges.size(); e++)
+    {
+        adj[fill[edges[e].first]++] = static_cast<uint32_t>(e);
+        adj[fill[edges[e].second]++] = static_cast<uint32_t>(e);
+    }
+}
+
+// Colours used by the other edges at the endpoints of `e`. The edges at
+// vertex v are adj[first[v] .. last[v]).
+template <typename ColorOf>
+uint64_t forbiddenColors(uint32_t e, uint32_t a, uint32_t b, const uint32_t *first, const uint32_t *last,
+                         const std::vector<uint32_t> &adj, ColorOf &&colorOf)
+{
+    uint64_t mask = 0;
+    for (uint32_t v : {a, b})
+    {
+        for (uint32_t i = first[v]; i < last[v]; i++)
+        {
+            uint8_t c = colorOf(adj[i]);
+            if (adj[i] != e && c != NO_COLOR)
+                mask |= uint64_t(1) << c;
+        }
+    }
+    return mask;
+}
+
+// Moves edges out of colours larger than the mean into colours smaller than
+// the mean, where neither endpoint already uses the smaller colour.
+inline void balanceColors(const std::vector<std::pair<uint32_t, uint32_t>> &edges, const uint32_t *first,
+                          const uint32_t *last, const std::vector<uint32_t> &adj, std::vector<uint8_t> &colors)
+{
+    size_t size[MAX_COLORS] = {};
+    int colorCount = 0;
+    for (uint8_t c : colors)
+    {
+        size[c]++;
+        colorCount = std::max(colorCount, c + 1);
+    }
+    if (colorCount < 2)
+        return;
+    size_t target = (edges.size() + colorCount - 1) / colorCount;
+
+    auto colorOf = [&](uint32_t f) { return colors[f]; };
+    for (size_t e = 0; e < edges.size(); e++)
+    {
+        uint8_t from = colors[e];
+        if (size[from] <= target)
+            continue;
+        uint64_t forbidden = forbiddenColors(static_cast<uint32_t>(e), edges[e].first, edges[e].second, first, last, adj, colorOf);
+
+        int best = -1;
+        for (int c = 0; c < colorCount; c++)
+            if (size[c] < target && !(forbidden >> c & 1) && (best < 0 || size[c] < size[best]))
+                best = c;
+        if (best >= 0)
+        {
+            colors[e] = static_cast<uint8_t>(best);
+            size[from]--;
+            size[best]++;
+        }
+    }
+}
+} // namespace detail
+
+/**
+ * ------------------------------------------------------------------
+ * FUNCTION: colorEdges
+ * Colours an edge list as described above. Returns false if some
+ * vertex needs more than MAX_COLORS colours.
+ * ------------------------------------------------------------------
+ */
+inline bool colorEdges(size_t vertexCount, const std::vector<std::pair<uint32_t, uint32_t>> &edges, WorkerPool *pool,
+                       std::vector<uint8_t> &colors)
+{
+    std::vector<uint32_t> offset, adj;
+    detail::edgeAdjacency(vertexCount, edges, offset, adj);
+
+    // Colours are read by neighbours while being written: relaxed atomics
+    std::unique_ptr<std::atomic<uint8_t>[]> color(new std::atomic<uint8_t>[edges.size()]);
+    for (size_t e = 0; e < edges.size(); e++)
+        color[e].store(NO_COLOR, std::memory_order_relaxed);
+    auto colorOf = [&](uint32_t f) { return color[f].load(std::memory_order_relaxed); };
+
+    unsigned workers = pool ? pool->size() : 1;
+    auto forRange = [&](const char *name, size_t n, auto &&fn)
+    {
+        if (pool)
+            pool->parallelFor(name, n, fn);
+        else if (n > 0)
+            fn(0, n, 0);
+    };
+
+    std::vector<uint32_t> work(edges.size());
+    for (size_t e = 0; e < edges.size(); e++)
+        work[e] = static_cast<uint32_t>(e);
+    std::vector<std::vector<uint32_t>> retry(workers);
+    std::atomic<bool> overflow{false};
+
+    while (!work.empty())
+    {
+        forRange("color edges", work.size(), [&](size_t begin, size_t end, unsigned)
+                 {
+                     for (size_t i = begin; i < end; i++)
+                     {
+                         uint32_t e = work[i];
+                         uint64_t free = ~detail::forbiddenColors(e, edges[e].first, edges[e].second, offset.data(), offset.data() + 1, adj, colorOf);
+                         if (free == 0)
+                         {
+                             overflow = true;
+                             return;
+                         }
+                         color[e].store(static_cast<uint8_t>(__builtin_ctzll(free)), std::memory_order_relaxed);
+                     } });
+        if (overflow)
+            return false;
+
+        // Conflicts: the higher-numbered edge of a clashing pair tries again
+        forRange("color conflicts", work.size(), [&](size_t begin, size_t end, unsigned w)
+                 {
+                     for (size_t i = begin; i < end; i++)
+                     {
+                         uint32_t e = work[i];
+                         uint8_t c = colorOf(e);
+                         bool clash = false;
+                         for (uint32_t v : {edges[e].first, edges[e].second})
+                             for (uint32_t j = offset[v]; j < offset[v + 1] && !clash; j++)
+                                 clash = adj[j] < e && colorOf(adj[j]) == c;
+                         if (clash)
+                             retry[w].push_back(e);
+                     } });
+
+        work.clear();
+        for (auto &r : retry)
+        {
+            for (uint32_t e : r)
+                color[e].store(NO_COLOR, std::memory_order_relaxed);
+            work.insert(work.end(), r.begin(), r.end());
+            r.clear();
+        }
+    }
+
+    colors.resize(edges.size());
+    for (size_t e = 0; e < edges.size(); e++)
+        colors[e] = colorOf(static_cast<uint32_t>(e));
+    detail::balanceColors(edges, offset.data(), offset.data() + 1, adj, colors);
+    return true;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * FUNCTION: colorLinks
+ * Colours the cloth's links with colorEdges() and sorts them into
+ * colour batches for the coloured solver.
+ * ------------------------------------------------------------------
+ */
+inline bool colorLinks(Cloth &cloth, WorkerPool *pool)
+{
+    std::vector<std::pair<uint32_t, uint32_t>> edges(cloth.links.size());
+    for (size_t l = 0; l < cloth.links.size(); l++)
+        edges[l] = {static_cast<uint32_t>(cloth.indexOf(cloth.links[l].p1)),
+                    static_cast<uint32_t>(cloth.indexOf(cloth.links[l].p2))};
+
+    std::vector<uint8_t> colors;
+    if (!colorEdges(cloth.points.size(), edges, pool, colors))
+        return false;
+    for (size_t l = 0; l < cloth.links.size(); l++)
+        cloth.links[l].color = colors[l];
+    cloth.sortByColor();
+    return true;
+}
+
+// Endpoints of recently removed links: a colour is free at each of
+// them, so they are where links can move into the batches that shrank.
+// Emptied once the batches are balanced again; a point is dropped after
+// a pass that moved nothing out of it.
+struct ColorFrontier
+{
+    std::vector<uint32_t> points;
+    std::vector<bool> listed;
+
+    void clear()
+    {
+        for (uint32_t v : points)
+            listed[v] = false;
+        points.clear();
+    }
+
+    void add(uint32_t v)
+    {
+        if (listed.size() <= v)
+            listed.resize(v + 1, false);
+        if (!listed[v])
+        {
+            listed[v] = true;
+            points.push_back(v);
+        }
+    }
+};
+
+/**
+ * ------------------------------------------------------------------
+ * FUNCTION: maintainColors
+ * Call after a step that removed links. Colours stay valid when links
+ * go away, so this only rebalances, and only once the largest batch has
+ * grown past COLOR_IMBALANCE times the mean batch size. A removed
+ * link's colour is free at both its endpoints, which `frontier`
+ * collects across frames until the batches are balanced; the links at
+ * those points that sit in an oversized batch move to the smallest
+ * undersized colour their endpoints allow (Cloth::moveToBatch), and a
+ * point that gives up no link is dropped. The cost follows the recently
+ * torn area: O(frontier x degree x colours), nothing per link.
+ * ------------------------------------------------------------------
+ */
+inline void maintainColors(Cloth &cloth, ColorFrontier &frontier)
+{
+    for (const TearEvent &e : cloth.frameTears)
+    {
+        frontier.add(e.p1);
+        frontier.add(e.p2);
+    }
+    if (!cloth.colorSorted || cloth.batchEnd.size() < 2 || cloth.links.empty() || frontier.points.empty())
+        return;
+
+    size_t size[MAX_COLORS] = {};
+    size_t largest = 0, begin = 0;
+    int colorCount = static_cast<int>(std::min<size_t>(cloth.batchEnd.size(), MAX_COLORS));
+    for (int c = 0; c < colorCount; c++)
+    {
+        size[c] = cloth.batchEnd[c] - begin;
+        largest = std::max(largest, size[c]);
+        begin = cloth.batchEnd[c];
+    }
+    float mean = static_cast<float>(cloth.links.size()) / cloth.batchEnd.size();
+    if (largest <= mean * COLOR_IMBALANCE)
+    {
+        frontier.clear();
+        return;
+    }
+
+    if (cloth.adjOffset.empty())
+        cloth.buildAdjacency();
+    size_t target = (cloth.links.size() + colorCount - 1) / colorCount;
+    auto colorOf = [&](uint32_t f) { return cloth.links[f].color; };
+    size_t kept = 0;
+    for (uint32_t v : frontier.points)
+    {
+        bool moved = false;
+        // Moves rewrite entries in place, so slot k always names a live link at v
+        for (uint32_t k = cloth.adjOffset[v]; k < cloth.adjEnd[v]; k++)
+        {
+            uint32_t l = cloth.adjLinks[k];
+            uint8_t from = cloth.links[l].color;
+            if (from >= colorCount || size[from] <= target)
+                continue;
+            uint32_t a = static_cast<uint32_t>(cloth.indexOf(cloth.links[l].p1));
+            uint32_t b = static_cast<uint32_t>(cloth.indexOf(cloth.links[l].p2));
+            uint64_t forbidden = detail::forbiddenColors(l, a, b, cloth.adjOffset.data(), cloth.adjEnd.data(),
+                                                         cloth.adjLinks, colorOf);
+            int best = -1;
+            for (int c = 0; c < colorCount; c++)
+                if (size[c] < target && !(forbidden >> c & 1) && (best < 0 || size[c] < size[best]))
+                    best = c;
+            if (best >= 0 && cloth.moveToBatch(l, static_cast<uint8_t>(best)))
+            {
+                size[from]--;
+                size[best]++;
+                moved = true;
+            }
+        }
+        if (moved)
+            frontier.points[kept++] = v;
+        else
+            frontier.listed[v] = false;
+    }
+    frontier.points.resize(kept);
+}
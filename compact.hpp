@@ -0,0 +1,310 @@
+/**
+ * ======================================================================================
+ * COMPACT CLOTH (16-bit quantized positions for memory-bound huge cloths)
+ * ======================================================================================
+ *
+ * At millions of particles the solver spends its time waiting for DRAM, so
+ * bytes per particle matter more than arithmetic. CompactCloth stores the
+ * state of a Cloth in half the space and decodes it on the fly:
+ *
+ *   Point (Cloth)              24 B   pos, prevPos as float3
+ *   CompactCloth               13 B   pos, prevPos as 3 x int16, 1 B pinned mask
+ *
+ *   Link (Cloth)               24 B   two pointers, rest length, flags
+ *   CompactCloth               13 B   two uint32 indices, rest length, alive
+ *
+ * Positions are fixed point relative to a tile: points [t * COMPACT_TILE,
+ * (t + 1) * COMPACT_TILE) share an origin and a scale,
+ *
+ *   pos = origin[t] + q * scale[t],     q in [-32767, 32767]
+ *
+ * and integration re-centres each tile around its points every frame,
+ * leaving COMPACT_MARGIN of headroom for the solver to move them before
+ * the next re-centre. A 64-point tile of the stock grid resolves ~0.02
+ * units (rest length 18), against ~0.35 units of gravity per frame.
+ * prevPos shares its point's tile frame: the Verlet velocity must include
+ * the solver's corrections, which a separately stored velocity would miss
+ * unless every correction also updated it.
+ *
+ * Pins are fixed where they were when the cloth was loaded; tears clear an
+ * `alive` flag rather than compacting, like LockstepCloth.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include "cloth.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+const int COMPACT_TILE = 64;                  // Points sharing one quantization origin
+const float COMPACT_MARGIN = 4.f * DISTANCE; // Headroom around a tile's bounding box
+
+struct CompactCloth
+{
+    // Particle i: position origin[t] + q * scale[t] with t = i / COMPACT_TILE,
+    // previous position origin[t] + r * scale[t].
+    std::vector<int16_t> qx, qy, qz;
+    std::vector<int16_t> rx, ry, rz;
+    std::vector<uint8_t> movable; // 0 for pinned particles (other masses are not kept: all 1)
+
+    // Per tile
+    std::vector<float> ox, oy, oz;
+    std::vector<float> scale, invScale;
+
+    // Link l joins particles linkA[l] and linkB[l]; colour c is
+    // [batchEnd[c - 1], batchEnd[c]) when the source cloth was colour-sorted.
+    std::vector<uint32_t> linkA, linkB;
+    std::vector<float> rest;
+    std::vector<uint8_t> alive;
+    std::vector<size_t> batchEnd;
+    bool colored = false;
+
+    WorkerPool *pool = nullptr;
+
+    size_t size() const { return movable.size(); }
+
+    // Bytes of simulation state (what the solver streams through).
+    size_t memoryBytes() const
+    {
+        return size() * (6 * sizeof(int16_t) + 1) + ox.size() * 5 * sizeof(float) +
+               rest.size() * (2 * sizeof(uint32_t) + sizeof(float) + 1);
+    }
+
+    void load(const Cloth &cloth)
+    {
+        size_t n = cloth.points.size(), tiles = (n + COMPACT_TILE - 1) / COMPACT_TILE;
+        for (auto *v : {&qx, &qy, &qz, &rx, &ry, &rz})
+            v->resize(n);
+        for (auto *v : {&ox, &oy, &oz, &scale, &invScale})
+            v->resize(tiles);
+        movable.assign(n, 1);
+        for (const Pin &p : cloth.pins)
+            movable[p.point] = 0;
+
+        Tile tile;
+        for (size_t t = 0; t < tiles; t++)
+        {
+            size_t begin = t * COMPACT_TILE, count = std::min<size_t>(COMPACT_TILE, n - begin);
+            for (size_t i = 0; i < count; i++)
+            {
+                const Point &p = cloth.points[begin + i];
+                tile.x[i] = p.pos.x;
+                tile.y[i] = p.pos.y;
+                tile.z[i] = p.pos.z;
+                tile.px[i] = p.prevPos.x;
+                tile.py[i] = p.prevPos.y;
+                tile.pz[i] = p.prevPos.z;
+            }
+            encodeTile(t, tile, count);
+        }
+
+        size_t m = cloth.links.size();
+        linkA.resize(m);
+        linkB.resize(m);
+        rest.resize(m);
+        alive.assign(m, 1);
+        for (size_t l = 0; l < m; l++)
+        {
+            linkA[l] = static_cast<uint32_t>(cloth.indexOf(cloth.links[l].p1));
+            linkB[l] = static_cast<uint32_t>(cloth.indexOf(cloth.links[l].p2));
+            rest[l] = cloth.links[l].targetDist;
+            alive[l] = !cloth.links[l].broken;
+        }
+        colored = cloth.colorSorted;
+        batchEnd = colored ? cloth.batchEnd : std::vector<size_t>{m};
+    }
+
+    sf::Vector3f position(size_t i) const
+    {
+        size_t t = i / COMPACT_TILE;
+        return {ox[t] + qx[i] * scale[t], oy[t] + qy[i] * scale[t], oz[t] + qz[i] * scale[t]};
+    }
+
+    // Cloth::step on the compact state. Returns the number of links that
+    // snapped this frame.
+    size_t step(float time, const SimParams &params)
+    {
+        size_t snapped = 0;
+        {
+            TraceScope span("solve");
+            unsigned workers = pool ? pool->size() : 1;
+            std::vector<size_t> partial(workers, 0);
+            for (int i = 0; i < params.iterations; i++)
+            {
+                size_t begin = 0;
+                for (size_t end : batchEnd)
+                {
+                    auto solve = [&](size_t lo, size_t hi, unsigned w)
+                    { partial[w] += solveLinks(begin + lo, begin + hi, params.stretchLimit); };
+                    if (colored && pool)
+                        pool->parallelFor("solve batch", end - begin, solve);
+                    else
+                        solve(0, end - begin, 0);
+                    begin = end;
+                }
+            }
+            for (size_t s : partial)
+                snapped += s;
+        }
+
+        {
+            TraceScope span("integrate");
+            size_t tiles = ox.size();
+            auto integrate = [&](size_t lo, size_t hi, unsigned)
+            {
+                for (size_t t = lo; t < hi; t++)
+                    integrateTile(t, time, params);
+            };
+            if (pool)
+                pool->parallelFor("integrate", tiles, integrate);
+            else
+                integrate(0, tiles, 0);
+        }
+        return snapped;
+    }
+
+    // Same formulation as Cloth::energy().
+    double energy(const SimParams &params) const
+    {
+        double e = 0.0;
+        for (size_t i = 0; i < size(); i++)
+        {
+            size_t t = i / COMPACT_TILE;
+            float vx = (qx[i] - rx[i]) * scale[t], vy = (qy[i] - ry[i]) * scale[t], vz = (qz[i] - rz[i]) * scale[t];
+            e += 0.5 * (vx * vx + vy * vy + vz * vz) - params.gravity * position(i).y;
+        }
+        return e;
+    }
+
+private:
+    // Decoded positions of one tile
+    struct Tile
+    {
+        float x[COMPACT_TILE], y[COMPACT_TILE], z[COMPACT_TILE];
+        float px[COMPACT_TILE], py[COMPACT_TILE], pz[COMPACT_TILE];
+    };
+
+    static int16_t quantize(float v, float origin, float inv)
+    {
+        return static_cast<int16_t>(std::lrint(std::min(std::max((v - origin) * inv, -32767.f), 32767.f)));
+    }
+
+    // Picks the tile's origin and scale for the given positions and stores them.
+    void encodeTile(size_t t, const Tile &tile, size_t count)
+    {
+        const float inf = std::numeric_limits<float>::max();
+        float lo[3] = {inf, inf, inf}, hi[3] = {-inf, -inf, -inf};
+        for (size_t i = 0; i < count; i++)
+        {
+            lo[0] = std::min({lo[0], tile.x[i], tile.px[i]});
+            hi[0] = std::max({hi[0], tile.x[i], tile.px[i]});
+            lo[1] = std::min({lo[1], tile.y[i], tile.py[i]});
+            hi[1] = std::max({hi[1], tile.y[i], tile.py[i]});
+            lo[2] = std::min({lo[2], tile.z[i], tile.pz[i]});
+            hi[2] = std::max({hi[2], tile.z[i], tile.pz[i]});
+        }
+        float half = std::max({hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]}) / 2.f;
+        ox[t] = (lo[0] + hi[0]) / 2.f;
+        oy[t] = (lo[1] + hi[1]) / 2.f;
+        oz[t] = (lo[2] + hi[2]) / 2.f;
+        scale[t] = (half + COMPACT_MARGIN) / 32767.f;
+        invScale[t] = 1.f / scale[t];
+
+        size_t base = t * COMPACT_TILE;
+        const float cx = ox[t], cy = oy[t], cz = oz[t], inv = invScale[t];
+#pragma GCC ivdep
+        for (size_t i = 0; i < count; i++)
+        {
+            qx[base + i] = quantize(tile.x[i], cx, inv);
+            qy[base + i] = quantize(tile.y[i], cy, inv);
+            qz[base + i] = quantize(tile.z[i], cz, inv);
+            rx[base + i] = quantize(tile.px[i], cx, inv);
+            ry[base + i] = quantize(tile.py[i], cy, inv);
+            rz[base + i] = quantize(tile.pz[i], cz, inv);
+        }
+    }
+
+    // Link::solve over [begin, end): decode both ends, correct, re-encode.
+    // The arrays are read through locals: the int16 stores could otherwise
+    // alias the vectors' own pointers and force reloads on every link.
+    size_t solveLinks(size_t begin, size_t end, float stretchLimit)
+    {
+        int16_t *X = qx.data(), *Y = qy.data(), *Z = qz.data();
+        const float *OX = ox.data(), *OY = oy.data(), *OZ = oz.data(), *S = scale.data(), *I = invScale.data();
+        const uint32_t *A = linkA.data(), *B = linkB.data();
+        const float *R = rest.data();
+        const uint8_t *M = movable.data();
+        uint8_t *ok = alive.data();
+
+        size_t snapped = 0;
+        for (size_t l = begin; l < end; l++)
+        {
+            if (!ok[l])
+                continue;
+            const uint32_t a = A[l], b = B[l];
+            const size_t ta = a / COMPACT_TILE, tb = b / COMPACT_TILE;
+            float ax = OX[ta] + X[a] * S[ta], ay = OY[ta] + Y[a] * S[ta], az = OZ[ta] + Z[a] * S[ta];
+            float bx = OX[tb] + X[b] * S[tb], by = OY[tb] + Y[b] * S[tb], bz = OZ[tb] + Z[b] * S[tb];
+
+            float ex = ax - bx, ey = ay - by, ez = az - bz;
+            float dist = std::sqrt(ex * ex + ey * ey + ez * ez);
+            if (dist > R[l] * stretchLimit)
+            {
+                ok[l] = 0;
+                snapped++;
+                continue;
+            }
+            if (dist < 0.1f)
+                continue;
+
+            // Shared by inverse mass (0 or 1): half each, or all to the free end
+            const float wa = M[a], wb = M[b];
+            float factor = (R[l] - dist) / (dist * std::max(wa + wb, 1.f));
+            float fa = factor * wa, fb = factor * wb;
+            X[a] = quantize(ax + ex * fa, OX[ta], I[ta]);
+            Y[a] = quantize(ay + ey * fa, OY[ta], I[ta]);
+            Z[a] = quantize(az + ez * fa, OZ[ta], I[ta]);
+            X[b] = quantize(bx - ex * fb, OX[tb], I[tb]);
+            Y[b] = quantize(by - ey * fb, OY[tb], I[tb]);
+            Z[b] = quantize(bz - ez * fb, OZ[tb], I[tb]);
+        }
+        return snapped;
+    }
+
+    // Point::update for one tile: decode, integrate, then re-centre and
+    // re-encode the tile.
+    void integrateTile(size_t t, float time, const SimParams &params)
+    {
+        size_t base = t * COMPACT_TILE, count = std::min<size_t>(COMPACT_TILE, size() - base);
+        Tile tile;
+        const float cx = ox[t], cy = oy[t], cz = oz[t], s = scale[t];
+        const float friction = params.airFriction, gravity = params.gravity;
+
+#pragma GCC ivdep
+        for (size_t i = 0; i < count; i++)
+        {
+            const size_t j = base + i;
+            const float m = movable[j];
+            float px = cx + qx[j] * s, py = cy + qy[j] * s, pz = cz + qz[j] * s;
+            float vx = (qx[j] - rx[j]) * s * friction, vy = (qy[j] - ry[j]) * s * friction,
+                  vz = (qz[j] - rz[j]) * s * friction;
+
+            float nx = px + vx;
+            float ny = py + vy + gravity;
+            float nz = (pz + vz + std::sin(time + nx * 0.05f) * params.wind) * params.zDamping;
+
+            // Pinned particles keep pos == prevPos
+            tile.x[i] = px + m * (nx - px);
+            tile.y[i] = py + m * (ny - py);
+            tile.z[i] = pz + m * (nz - pz);
+            tile.px[i] = px;
+            tile.py[i] = py;
+            tile.pz[i] = pz;
+        }
+        encodeTile(t, tile, count);
+    }
+};
@@ -0,0 +1,284 @@
+/**
+ * ======================================================================================
+ * CONVERGENCE REPORT (Parallel solvers against the serial baseline)
+ * ======================================================================================
+ *
+ * The parallel solvers do not visit the links in the serial order, and the
+ * chaotic one does not even visit them in the same order twice. This report
+ * measures what that costs. For every cloth size it first runs the serial
+ * solver (one Gauss-Seidel sweep in link order, Link::solve) as the
+ * reference, then every other solver and thread count `runs` times, all
+ * from the same start for the same number of frames, and records
+ *
+ *   final_residual    Cloth::residual after the last frame
+ *   mean_residual     ...averaged over every frame
+ *   peak_residual     ...the worst frame (a spike is a solver hiccup)
+ *   final_energy      Cloth::energy() after the last frame
+ *   rms_vs_serial     RMS distance of the final positions from the reference's
+ *   max_vs_serial     ...the largest one
+ *   max_vs_first      largest distance from this configuration's first run
+ *                     (0 for deterministic solvers)
+ *   residual_ratio    mean_residual over the reference's
+ *   stable            every position finite, no more tears than the
+ *                     reference plus `tearSlack`, and residual_ratio at
+ *                     most `residualSlack`
+ *
+ * Rows go to a CSV; the exit code is 2 if any row is unstable.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include "cli.hpp"
+#include "cloth.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ConvergeConfig
+{
+    std::vector<std::string> sizes{"70x45", "256x256"};
+    std::vector<std::string> solvers{"colored", "vertex", "chaotic"};
+    std::vector<unsigned> threads; // Empty = 1, 2, 4, ... up to every core
+    int frames = 300;
+    int runs = 3;                  // Repeats per configuration
+    int iterations = ITERATIONS;
+    size_t tearSlack = 0;          // Extra tears over the reference still counted as stable
+    double residualSlack = 1.5;    // Largest residual_ratio still counted as stable (0 = unchecked)
+    std::string outPath = "converge.csv";
+};
+
+struct ConvergeRow
+{
+    int width = 0, height = 0;
+    std::string solver;
+    unsigned threads = 1;
+    int run = 0;
+    size_t tears = 0;
+    double finalResidual = 0.0, meanResidual = 0.0, peakResidual = 0.0;
+    double energy = 0.0;
+    double rmsVsSerial = 0.0, maxVsSerial = 0.0, maxVsFirst = 0.0;
+    double residualRatio = 1.0;
+    bool stable = true;
+    double stepsPerSec = 0.0;
+};
+
+// One simulated run: the row's measurements plus the final positions.
+inline ConvergeRow convergeRun(int width, int height, SolverMode solver, unsigned threads, const ConvergeConfig &cfg,
+                               std::vector<sf::Vector3f> &positions)
+{
+    ConvergeRow row;
+    row.width = width;
+    row.height = height;
+    row.solver = solverName(solver);
+    row.threads = threads;
+
+    SimParams params;
+    params.solver = solver;
+    params.iterations = cfg.iterations;
+    WorkerPool pool(threads);
+    Cloth cloth;
+    cloth.pool = &pool;
+    cloth.buildGrid(width, height);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < cfg.frames; frame++)
+    {
+        row.tears += cloth.step(frame * FRAME_TIME * 1.5f, params);
+        row.meanResidual += cloth.residual;
+        row.peakResidual = std::max(row.peakResidual, cloth.residual);
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    row.finalResidual = cloth.residual;
+    row.meanResidual /= std::max(1, cfg.frames);
+    row.energy = cloth.energy(params);
+    row.stepsPerSec = elapsed > 0.0 ? cfg.frames / elapsed : 0.0;
+
+    positions.resize(cloth.points.size());
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        positions[i] = cloth.points[i].pos;
+        row.stable = row.stable && std::isfinite(positions[i].x) && std::isfinite(positions[i].y) &&
+                     std::isfinite(positions[i].z);
+    }
+    return row;
+}
+
+// Largest and RMS distance between two runs' positions.
+inline void positionGap(const std::vector<sf::Vector3f> &a, const std::vector<sf::Vector3f> &b, double &rms,
+                        double &max)
+{
+    rms = max = 0.0;
+    size_t n = std::min(a.size(), b.size());
+    for (size_t i = 0; i < n; i++)
+    {
+        sf::Vector3f d = a[i] - b[i];
+        double sq = d.x * d.x + d.y * d.y + d.z * d.z;
+        rms += sq;
+        max = std::max(max, std::sqrt(sq));
+    }
+    rms = n ? std::sqrt(rms / n) : 0.0;
+}
+
+inline const char *CONVERGE_CSV_HEADER =
+    "width,height,solver,threads,run,frames,tears,final_residual,mean_residual,peak_residual,final_energy,"
+    "rms_vs_serial,max_vs_serial,max_vs_first,residual_ratio,stable,steps_per_s";
+
+inline bool writeConvergeCsv(const std::string &path, const std::vector<ConvergeRow> &rows, int frames)
+{
+    std::ofstream out(path);
+    if (!out)
+        return false;
+    out << CONVERGE_CSV_HEADER << '\n';
+    for (const ConvergeRow &r : rows)
+    {
+        out << r.width << ',' << r.height << ',' << r.solver << ',' << r.threads << ',' << r.run << ',' << frames
+            << ',' << r.tears << ',' << r.finalResidual << ',' << r.meanResidual << ',' << r.peakResidual << ','
+            << r.energy << ',' << r.rmsVsSerial << ',' << r.maxVsSerial << ',' << r.maxVsFirst << ','
+            << r.residualRatio << ',' << (r.stable ? 1 : 0) << ',' << r.stepsPerSec << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+/**
+ * ------------------------------------------------------------------
+ * FUNCTION: runConverge
+ * Runs the reference and every configuration, prints the table and
+ * writes the CSV. Returns the process exit code (2 if anything was
+ * unstable).
+ * ------------------------------------------------------------------
+ */
+inline int runConverge(ConvergeConfig cfg)
+{
+    if (cfg.threads.empty())
+    {
+        unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned t = 1; t < cores; t *= 2)
+            cfg.threads.push_back(t);
+        cfg.threads.push_back(cores);
+    }
+
+    std::vector<ConvergeRow> rows;
+    int unstable = 0;
+    std::printf("%-10s %-8s %7s %3s %6s %10s %10s %10s %12s %10s %10s %10s %8s %s\n", "size", "solver", "threads",
+                "run", "tears", "residual", "mean", "peak", "energy", "rms/ser", "max/ser", "max/first", "res/ser", "");
+    auto print = [&](const std::string &size, const ConvergeRow &r)
+    {
+        std::printf("%-10s %-8s %7u %3d %6zu %10.5f %10.5f %10.5f %12.1f %10.4f %10.4f %10.4f %8.3f %s\n",
+                    size.c_str(), r.solver.c_str(), r.threads, r.run, r.tears, r.finalResidual, r.meanResidual,
+                    r.peakResidual, r.energy, r.rmsVsSerial, r.maxVsSerial, r.maxVsFirst, r.residualRatio,
+                    r.stable ? "" : "UNSTABLE");
+        std::fflush(stdout);
+    };
+
+    for (const std::string &size : cfg.sizes)
+    {
+        int width = 0, height = 0;
+        parseSize(size, width, height);
+
+        std::vector<sf::Vector3f> reference, first, positions;
+        ConvergeRow serial = convergeRun(width, height, SolverMode::Serial, 1, cfg, reference);
+        rows.push_back(serial);
+        unstable += !serial.stable;
+        print(size, serial);
+
+        for (const std::string &name : cfg.solvers)
+        {
+            SolverMode mode = SolverMode::Serial;
+            parseSolverMode(name, mode);
+            if (mode == SolverMode::Serial)
+                continue; // That is the reference
+            for (unsigned threads : cfg.threads)
+            {
+                for (int run = 0; run < cfg.runs; run++)
+                {
+                    ConvergeRow r = convergeRun(width, height, mode, threads, cfg, run == 0 ? first : positions);
+                    r.run = run;
+                    positionGap(run == 0 ? first : positions, reference, r.rmsVsSerial, r.maxVsSerial);
+                    if (run > 0)
+                    {
+                        double rms;
+                        positionGap(positions, first, rms, r.maxVsFirst);
+                    }
+                    r.residualRatio = serial.meanResidual > 0.0 ? r.meanResidual / serial.meanResidual : 1.0;
+                    r.stable = r.stable && r.tears <= serial.tears + cfg.tearSlack &&
+                               (cfg.residualSlack <= 0.0 || r.residualRatio <= cfg.residualSlack);
+                    unstable += !r.stable;
+                    rows.push_back(r);
+                    print(size, r);
+                }
+            }
+        }
+    }
+
+    if (!writeConvergeCsv(cfg.outPath, rows, cfg.frames))
+    {
+        std::cerr << "Could not write " << cfg.outPath << "\n";
+        return 1;
+    }
+    std::cout << "Wrote " << rows.size() << " rows to " << cfg.outPath << "\n";
+    return unstable ? 2 : 0;
+}
+
+inline bool parseConvergeArgs(int argc, char **argv, ConvergeConfig &cfg)
+{
+    for (int i = 0; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+
+        if (arg == "--sizes")
+        {
+            ok = parseList(value, cfg.sizes);
+            int w, h;
+            for (const std::string &s : cfg.sizes)
+                ok = ok && parseSize(s, w, h);
+        }
+        else if (arg == "--solvers")
+        {
+            ok = parseList(value, cfg.solvers);
+            SolverMode mode;
+            for (const std::string &s : cfg.solvers)
+                ok = ok && parseSolverMode(s, mode);
+        }
+        else if (arg == "--threads")
+            ok = parseThreadList(value, cfg.threads);
+        else if (arg == "--frames")
+            ok = (cfg.frames = std::atoi(value.c_str())) > 0;
+        else if (arg == "--runs")
+            ok = (cfg.runs = std::atoi(value.c_str())) > 0;
+        else if (arg == "--iterations")
+            ok = (cfg.iterations = std::atoi(value.c_str())) > 0;
+        else if (arg == "--tear-slack")
+            cfg.tearSlack = static_cast<size_t>(std::max(0, std::atoi(value.c_str())));
+        else if (arg == "--residual-slack")
+            ok = (cfg.residualSlack = std::atof(value.c_str())) >= 0.0;
+        else if (arg == "--out")
+            cfg.outPath = value;
+        else
+        {
+            std::cerr << "Unknown converge option " << arg << "\n";
+            return false;
+        }
+
+        if (!ok)
+        {
+            std::cerr << "Bad value for " << arg << ": " << value << "\n";
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,286 @@
+/**
+ * ======================================================================================
+ * ENSEMBLE RUNNER (Headless parameter sweeps)
+ * ======================================================================================
+ *
+ * Runs many independent cloths, one per parameter combination, spread over
+ * a pool of worker threads. No window is opened.
+ *
+ *   jobs:   [g0,f0,s0,i0,n0] [g0,f0,s0,i0,n1] ... [gN,fN,sN,iN,nN]   (cartesian product)
+ *              |             |                  |
+ *   worker 0 --+  worker 1 --+   ...  worker k --+           (atomic job counter)
+ *
+ * Each worker owns one Cloth and rebuilds it in place for every job, so
+ * after the first job a worker never allocates again. Results are written
+ * into a pre-sized vector by job index (no locking) and dumped as one CSV.
+ *
+ * Each row also records the final residual (mean relative stretch of the
+ * links), so iteration / substep mixes can be compared on stiffness per
+ * millisecond.
+ *
+ * With `lockstep` set, jobs sharing an iteration count are packed into
+ * batches of LOCKSTEP_LANES and each batch is one LockstepEnsemble
+ * (see lockstep.hpp), so a worker steps K variants per pass.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include "cli.hpp"
+#include "cloth.hpp"
+#include "lockstep.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct EnsembleConfig
+{
+    std::vector<float> gravity{GRAVITY};
+    std::vector<float> airFriction{AIR_FRICTION};
+    std::vector<float> stretchLimit{STRETCH_LIMIT};
+    std::vector<int> iterations{ITERATIONS};
+    std::vector<int> substeps{SUBSTEPS};
+    int frames = 600; // 10 seconds at 60 FPS
+    int width = WIDTH;
+    int height = HEIGHT;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string outPath = "ensemble.csv";
+    bool lockstep = false; // Step LOCKSTEP_LANES variants per vectorized pass
+    std::string tracePath;  // Chrome trace of every job, written after the sweep (empty = off)
+};
+
+struct EnsembleResult
+{
+    SimParams params;
+    size_t tears = 0;     // Links lost over the whole run
+    double energy = 0.0;  // Cloth::energy() after the last frame
+    double residual = NAN; // Cloth::residual after the last frame (not tracked in lock-step)
+    double millis = 0.0;  // Wall time spent simulating this job
+};
+
+/**
+ * ------------------------------------------------------------------
+ * FUNCTION: runEnsemble
+ * Expands the config into its cartesian product and simulates every
+ * combination for `frames` frames.
+ * ------------------------------------------------------------------
+ */
+inline std::vector<EnsembleResult> runEnsemble(const EnsembleConfig &cfg)
+{
+    Tracer::instance().setEnabled(!cfg.tracePath.empty());
+
+    std::vector<EnsembleResult> results;
+    for (float g : cfg.gravity)
+        for (float f : cfg.airFriction)
+            for (float s : cfg.stretchLimit)
+                for (int it : cfg.iterations)
+                    for (int n : cfg.substeps)
+                    {
+                        EnsembleResult r;
+                        r.params.gravity = g;
+                        r.params.airFriction = f;
+                        r.params.stretchLimit = s;
+                        r.params.iterations = it;
+                        r.params.substeps = n;
+                        results.push_back(r);
+                    }
+
+    // Lock-step mode: jobs are grouped by iteration count (shared per batch)
+    // and cut into batches of at most LOCKSTEP_LANES.
+    std::vector<std::vector<size_t>> batches;
+    if (cfg.lockstep)
+    {
+        for (int it : cfg.iterations)
+        {
+            for (size_t job = 0; job < results.size(); job++)
+            {
+                if (results[job].params.iterations != it)
+                    continue;
+                if (batches.empty() || batches.back().size() == LOCKSTEP_LANES ||
+                    results[batches.back().front()].params.iterations != it)
+                    batches.emplace_back();
+                batches.back().push_back(job);
+            }
+        }
+    }
+
+    std::atomic<size_t> nextJob{0};
+    auto lockstepWorker = [&]()
+    {
+        LockstepEnsemble ensemble; // Reused for every batch this worker picks up
+        for (size_t batch = nextJob++; batch < batches.size(); batch = nextJob++)
+        {
+            TraceScope span("lockstep batch");
+            const std::vector<size_t> &jobs = batches[batch];
+            auto start = std::chrono::steady_clock::now();
+
+            // Unused lanes repeat the last job; their results are dropped
+            std::array<SimParams, LOCKSTEP_LANES> lanes;
+            for (int k = 0; k < LOCKSTEP_LANES; k++)
+                lanes[k] = results[jobs[std::min<size_t>(k, jobs.size() - 1)]].params;
+
+            std::array<size_t, LOCKSTEP_LANES> tears{};
+            ensemble.buildGrid(cfg.width, cfg.height, lanes);
+            for (int frame = 0; frame < cfg.frames; frame++)
+                ensemble.step(frame * FRAME_TIME * 1.5f, tears);
+            std::array<double, LOCKSTEP_LANES> energy = ensemble.energy();
+
+            // The batch's wall time is shared evenly by its jobs
+            double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            for (size_t k = 0; k < jobs.size(); k++)
+            {
+                EnsembleResult &r = results[jobs[k]];
+                r.tears = tears[k];
+                r.energy = energy[k];
+                r.millis = millis / jobs.size();
+            }
+        }
+    };
+
+    auto worker = [&]()
+    {
+        Cloth cloth; // Reused for every job this worker picks up
+        for (size_t job = nextJob++; job < results.size(); job = nextJob++)
+        {
+            TraceScope span("ensemble job");
+            EnsembleResult &r = results[job];
+            auto start = std::chrono::steady_clock::now();
+
+            cloth.buildGrid(cfg.width, cfg.height);
+            for (int frame = 0; frame < cfg.frames; frame++)
+                r.tears += cloth.step(frame * FRAME_TIME * 1.5f, r.params);
+            r.energy = cloth.energy(r.params);
+            r.residual = cloth.residual;
+
+            r.millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    };
+
+    size_t work = cfg.lockstep ? batches.size() : results.size();
+    std::atomic<unsigned> workerId{0};
+    auto run = [&]()
+    {
+        Tracer::instance().setThreadName("ensemble worker " + std::to_string(workerId++));
+        if (cfg.lockstep)
+            lockstepWorker();
+        else
+            worker();
+    };
+
+    unsigned threadCount = std::max(1u, std::min<unsigned>(cfg.threads, static_cast<unsigned>(work)));
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threadCount; t++)
+        pool.emplace_back(run);
+    run(); // The calling thread works too
+    for (auto &t : pool)
+        t.join();
+
+    if (!cfg.tracePath.empty() && !Tracer::instance().dump(cfg.tracePath))
+        std::cerr << "Could not write " << cfg.tracePath << "\n";
+
+    return results;
+}
+
+inline bool writeEnsembleCsv(const std::string &path, const EnsembleConfig &cfg, const std::vector<EnsembleResult> &results)
+{
+    std::ofstream out(path);
+    if (!out)
+        return false;
+
+    out << "gravity,air_friction,stretch_limit,iterations,substeps,frames,tears,final_energy,final_residual,millis\n";
+    for (const auto &r : results)
+    {
+        out << r.params.gravity << ',' << r.params.airFriction << ',' << r.params.stretchLimit << ','
+            << r.params.iterations << ',' << r.params.substeps << ',' << cfg.frames << ',' << r.tears << ','
+            << r.energy << ',';
+        if (!std::isnan(r.residual))
+            out << r.residual;
+        out << ',' << r.millis << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+/**
+ * ------------------------------------------------------------------
+ * FUNCTION: parseEnsembleArgs
+ * Reads the flags following `--ensemble`. List flags take
+ * comma-separated values, e.g. `--gravity 0.2,0.35,0.5`.
+ * ------------------------------------------------------------------
+ */
+inline bool parseEnsembleArgs(int argc, char **argv, EnsembleConfig &cfg)
+{
+    for (int i = 0; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--lockstep")
+        {
+            cfg.lockstep = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+
+        if (arg == "--gravity")
+            ok = parseList(value, cfg.gravity);
+        else if (arg == "--friction")
+            ok = parseList(value, cfg.airFriction);
+        else if (arg == "--stretch")
+            ok = parseList(value, cfg.stretchLimit);
+        else if (arg == "--iterations")
+        {
+            // Sorted and unique: lock-step batches are grouped per value
+            ok = parseList(value, cfg.iterations);
+            for (int n : cfg.iterations)
+                ok = ok && n >= 1;
+            std::sort(cfg.iterations.begin(), cfg.iterations.end());
+            cfg.iterations.erase(std::unique(cfg.iterations.begin(), cfg.iterations.end()), cfg.iterations.end());
+        }
+        else if (arg == "--substeps")
+        {
+            ok = parseList(value, cfg.substeps);
+            for (int n : cfg.substeps)
+                ok = ok && n >= 1;
+        }
+        else if (arg == "--frames")
+            cfg.frames = std::atoi(value.c_str());
+        else if (arg == "--size")
+            ok = parseSize(value, cfg.width, cfg.height);
+        else if (arg == "--threads")
+            cfg.threads = static_cast<unsigned>(std::max(1, std::atoi(value.c_str())));
+        else if (arg == "--out")
+            cfg.outPath = value;
+        else if (arg == "--trace")
+            cfg.tracePath = value;
+        else
+        {
+            std::cerr << "Unknown ensemble option " << arg << "\n";
+            return false;
+        }
+
+        if (!ok)
+        {
+            std::cerr << "Bad value for " << arg << ": " << value << "\n";
+            return false;
+        }
+    }
+    if (cfg.lockstep && (cfg.substeps.size() != 1 || cfg.substeps[0] != 1))
+    {
+        std::cerr << "--lockstep runs one step per frame; drop --substeps\n";
+        return false;
+    }
+    return cfg.width > 1 && cfg.height > 1 && cfg.frames >= 0;
+}
@@ -0,0 +1,152 @@
+/**
+ * ======================================================================================
+ * FRAME TASK GRAPH (Phases that declare what they read and write)
+ * ======================================================================================
+ *
+ * A frame is a list of tasks, each declaring the resources it reads and
+ * writes (bit flags, FRAME_POSITIONS etc.). Declaration order is program
+ * order, and the usual hazards decide what must wait for what:
+ *
+ *   write -> read     read after write
+ *   write -> write    write after write
+ *   read  -> write    write after read
+ *
+ * compile() assigns each task the earliest wave after everything it
+ * waits for. Tasks in the same wave touch disjoint data:
+ *
+ *   wave 0   events [main]         telemetry
+ *   wave 1   grab
+ *   wave 2   cut
+ *   wave 3   step
+ *   wave 4   colors   grab index   project         <- topology vs positions
+ *   wave 5   vertices
+ *   wave 6   draw [main]
+ *
+ * run() goes wave by wave. A wave with one active task runs it on the
+ * calling thread, where it can fork the pool itself (the solver does).
+ * A wave with several runs them side by side, one per worker; pool forks
+ * inside them then run inline (WorkerPool::run). Tasks marked mainThread
+ * (window and input calls) always run on the calling thread.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include "parallel.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Frame resources
+const uint32_t FRAME_INPUT = 1u << 0;       // Mouse state, grab and brush selection
+const uint32_t FRAME_PINS = 1u << 1;        // Cloth::pins
+const uint32_t FRAME_POSITIONS = 1u << 2;   // Point positions
+const uint32_t FRAME_TOPOLOGY = 1u << 3;    // Links: order, colours, broken flags
+const uint32_t FRAME_STATS = 1u << 4;       // Per-frame results (tears, residual)
+const uint32_t FRAME_PROJECTIONS = 1u << 5; // Screen positions of the points
+const uint32_t FRAME_VERTICES = 1u << 6;    // Render vertex buffer
+const uint32_t FRAME_WINDOW = 1u << 7;      // The window and its GL context
+const uint32_t FRAME_RECORD = 1u << 8;      // Last frame's telemetry record
+const uint32_t FRAME_GRAB_INDEX = 1u << 9;  // Spatial grid the grabs query
+
+struct FrameTask
+{
+    const char *name;
+    uint32_t reads, writes;
+    std::function<void()> fn;
+    std::function<bool()> active; // Empty = always runs
+    bool mainThread = false;
+    int wave = 0;
+};
+
+class FrameGraph
+{
+public:
+    // Adds a task after all the ones added so far.
+    FrameTask &add(const char *name, uint32_t reads, uint32_t writes, std::function<void()> fn)
+    {
+        tasks.push_back(FrameTask{name, reads, writes, std::move(fn), nullptr});
+        compiled = false;
+        return tasks.back();
+    }
+
+    // Assigns the waves. O(tasks^2), once.
+    void compile()
+    {
+        waves.clear();
+        for (size_t j = 0; j < tasks.size(); j++)
+        {
+            FrameTask &t = tasks[j];
+            t.wave = 0;
+            for (size_t i = 0; i < j; i++)
+                if (conflicts(tasks[i], t))
+                    t.wave = std::max(t.wave, tasks[i].wave + 1);
+            if (waves.size() <= static_cast<size_t>(t.wave))
+                waves.resize(t.wave + 1);
+            waves[t.wave].push_back(j);
+        }
+        compiled = true;
+    }
+
+    const std::vector<FrameTask> &list() const { return tasks; }
+
+    // Runs one frame.
+    void run(WorkerPool &pool)
+    {
+        if (!compiled)
+            compile();
+
+        std::vector<FrameTask *> ready, main;
+        for (const std::vector<size_t> &wave : waves)
+        {
+            ready.clear();
+            main.clear();
+            for (size_t j : wave)
+            {
+                FrameTask &t = tasks[j];
+                if (!t.active || t.active())
+                    (t.mainThread ? main : ready).push_back(&t);
+            }
+
+            if (ready.size() + main.size() <= 1 || pool.size() == 1)
+            {
+                for (FrameTask *t : main)
+                    execute(*t);
+                for (FrameTask *t : ready)
+                    execute(*t);
+                continue;
+            }
+
+            // Worker 0 is this thread: it takes the main-thread tasks, then
+            // helps with the rest
+            std::atomic<size_t> next{0};
+            pool.run("frame tasks", [&](unsigned w)
+                     {
+                         if (w == 0)
+                             for (FrameTask *t : main)
+                                 execute(*t);
+                         for (size_t k = next++; k < ready.size(); k = next++)
+                             execute(*ready[k]); });
+        }
+    }
+
+private:
+    static bool conflicts(const FrameTask &before, const FrameTask &after)
+    {
+        return (before.writes & (after.reads | after.writes)) || (before.reads & after.writes) ||
+               (before.mainThread && after.mainThread);
+    }
+
+    static void execute(FrameTask &t)
+    {
+        TraceScope span(t.name);
+        t.fn();
+    }
+
+    std::vector<FrameTask> tasks;
+    std::vector<std::vector<size_t>> waves;
+    bool compiled = false;
+};
@@ -0,0 +1,102 @@
+/**
+ * ======================================================================================
+ * FRAME-TIME GOVERNOR (Trade quality for a steady frame rate)
+ * ======================================================================================
+ *
+ * Watches how long each frame's work takes (the wait for the frame-rate
+ * limiter excluded) and turns quality knobs to hold a target:
+ *
+ *   busy ms  ^
+ *            |   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  target * (1 + band)   degrade above
+ *            |   - - - - - - - - - - - - - - - -  target
+ *            |   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  target * (1 - band)   restore below
+ *
+ * The frame time is smoothed (GOVERNOR_SMOOTHING) and, after every change,
+ * the governor waits `settleFrames` before judging again, so one slow frame
+ * or the transient right after a change never flips a knob back and forth.
+ *
+ * Each knob is an int with a best and a worst value (either may be the
+ * larger). Knobs are degraded one step at a time in the order they were
+ * added and restored in reverse order, so the knob given up first is the
+ * last one restored. Every change is logged with the frame time that
+ * triggered it.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+const float GOVERNOR_TARGET_MS = 1000.f / 60.f;
+const float GOVERNOR_BAND = 0.1f;       // Hysteresis, as a fraction of the target
+const float GOVERNOR_SMOOTHING = 0.1f;  // Weight of the newest frame in the average
+const int GOVERNOR_SETTLE_FRAMES = 30;  // Frames between changes
+
+struct GovernorKnob
+{
+    std::string name;
+    int *value;
+    int best, worst;
+
+    int direction() const { return worst < best ? -1 : 1; } // Step towards worst
+    bool canDegrade() const { return *value != worst; }
+    bool canRestore() const { return *value != best; }
+};
+
+class FrameGovernor
+{
+public:
+    float targetMs = GOVERNOR_TARGET_MS;
+    float band = GOVERNOR_BAND;
+    int settleFrames = GOVERNOR_SETTLE_FRAMES;
+
+    // `value` starts (and is restored up to) `best`.
+    void addKnob(const std::string &name, int &value, int best, int worst)
+    {
+        value = best;
+        knobs.push_back(GovernorKnob{name, &value, best, worst});
+    }
+
+    float averageMs() const { return average; }
+
+    // Feeds one frame's busy time. Returns true if a knob changed.
+    bool update(float busyMs)
+    {
+        average = frames++ == 0 ? busyMs : average + (busyMs - average) * GOVERNOR_SMOOTHING;
+        if (cooldown > 0 && --cooldown > 0)
+            return false;
+
+        if (average > targetMs * (1.f + band))
+        {
+            for (GovernorKnob &k : knobs)
+                if (k.canDegrade())
+                    return change(k, k.direction(), "over");
+        }
+        else if (average < targetMs * (1.f - band))
+        {
+            for (auto k = knobs.rbegin(); k != knobs.rend(); ++k)
+                if (k->canRestore())
+                    return change(*k, -k->direction(), "under");
+        }
+        return false;
+    }
+
+private:
+    bool change(GovernorKnob &k, int step, const char *side)
+    {
+        int before = *k.value;
+        *k.value += step;
+        std::printf("governor: %s %d -> %d (%.1f ms %s %.1f ms target)\n", k.name.c_str(), before, *k.value,
+                    average, side, targetMs);
+        std::fflush(stdout);
+        cooldown = settleFrames;
+        return true;
+    }
+
+    std::vector<GovernorKnob> knobs;
+    float average = 0.f;
+    long frames = 0;
+    int cooldown = 0;
+};
@@ -0,0 +1,73 @@
+/**
+ * ======================================================================================
+ * BRUSH GRAB (Drag every point under the cursor's circle)
+ * ======================================================================================
+ *
+ * Grabbing a single point of a big cloth tears it at once: one particle
+ * drags thousands. The brush captures every free point within a radius,
+ * each with its offset from the grab anchor and a falloff weight
+ *
+ *   w = (1 - (d / radius)^2)^2      1 at the centre, 0 at the rim
+ *
+ * and every frame pulls each point the fraction w of the way to
+ * anchor + offset. The solver then settles the rim against the rest of
+ * the cloth, so the load spreads over the whole patch.
+ *
+ * The captured points are stored structure-of-arrays and moved in one
+ * pass with no branches, so large brushes stay cheap.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include "cloth.hpp"
+#include <cstdint>
+#include <vector>
+
+const float BRUSH_RADIUS = 80.f; // Default brush radius in pixels
+
+struct BrushGrab
+{
+    std::vector<uint32_t> points;
+    std::vector<float> ox, oy, oz; // Offset from the anchor at capture
+    std::vector<float> weight;
+    float anchorZ = 0.f; // Depth the cursor is un-projected at
+
+    bool active() const { return !points.empty(); }
+
+    void clear()
+    {
+        for (auto *v : {&ox, &oy, &oz, &weight})
+            v->clear();
+        points.clear();
+    }
+
+    // `distance` is the point's distance from the brush centre, in the
+    // same units as `radius`.
+    void add(uint32_t point, sf::Vector3f offset, float distance, float radius)
+    {
+        float s = 1.f - (distance * distance) / (radius * radius);
+        points.push_back(point);
+        ox.push_back(offset.x);
+        oy.push_back(offset.y);
+        oz.push_back(offset.z);
+        weight.push_back(s * s);
+    }
+
+    // Pulls the captured points towards anchor + offset. prevPos moves
+    // with pos, so the drag itself adds no velocity (no slingshot).
+    void drag(Cloth &cloth, sf::Vector3f anchor)
+    {
+        Point *p = cloth.points.data();
+        const size_t n = points.size();
+#pragma GCC ivdep
+        for (size_t i = 0; i < n; i++)
+        {
+            Point &q = p[points[i]];
+            sf::Vector3f d((anchor.x + ox[i] - q.pos.x) * weight[i], (anchor.y + oy[i] - q.pos.y) * weight[i],
+                           (anchor.z + oz[i] - q.pos.z) * weight[i]);
+            q.pos += d;
+            q.prevPos += d;
+        }
+    }
+};
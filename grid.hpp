@@ -0,0 +1,301 @@
+/**
+ * ======================================================================================
+ * GRID CLOTH (Implicit links for the rectangular cloth)
+ * ======================================================================================
+ *
+ * In the cloth buildGrid() makes, every link is implied by its first point:
+ * point i = y * width + x has a link to its right (i + 1) and one down
+ * (i + width), all with the same rest length. GridCloth stores no links at
+ * all, only which of a point's two links have broken:
+ *
+ *   Link (Cloth)               24 B per link   two pointers, rest length, flags
+ *   GridCloth                  1 B per point   bit 0 right, bit 1 down (0.5 B per link)
+ *
+ * Positions are structure-of-arrays, so the solver walks contiguous memory.
+ * The colour batches of buildGrid() map to whole rows:
+ *
+ *   colour 0/1   right links with x even / odd: every row, stride 2
+ *   colour 2/3   down links with y even / odd: rows y and y + 1, stride 1
+ *
+ * A batch is one branch-free loop per row that the compiler vectorizes,
+ * and the batches run in the same order as the coloured Cloth solver.
+ *
+ * The aerodynamics pass (triangleAero) uses the two triangles of every
+ * cell, (i, i + 1, i + w) and (i + 1, i + w + 1, i + w), one
+ * branch-free loop per row of cells. Each cell's two corner shares go to
+ * a padded (width + 1) x (height + 1) array, so each point gathers its
+ * six triangles with no edge cases.
+ *
+ * Pins are fixed where they were when the cloth was loaded (zero inverse
+ * mass); the other points keep the cloth's masses. Tears set a bit and
+ * remove nothing, like CompactCloth.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include "cloth.hpp"
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+const uint8_t GRID_RIGHT_BROKEN = 1;
+const uint8_t GRID_DOWN_BROKEN = 2;
+
+struct GridCloth
+{
+    int width = 0, height = 0;
+    float rest = DISTANCE;
+
+    // Point i = y * width + x
+    std::vector<float> x, y, z;
+    std::vector<float> px, py, pz; // Previous positions
+    std::vector<float> invMass;    // Point::invMass (0 for pinned points)
+    std::vector<uint8_t> broken;   // GRID_RIGHT_BROKEN | GRID_DOWN_BROKEN; links off the edge count as broken
+
+    // Aerodynamics: a corner's share of cell (x, y)'s triangle A / B at
+    // (y + 1) * (width + 1) + x + 1. Sized when first used.
+    std::vector<float> ax, ay, az, bx, by, bz;
+
+    WorkerPool *pool = nullptr;
+
+    size_t size() const { return x.size(); }
+
+    // Bytes of simulation state (what the solver streams through).
+    size_t memoryBytes() const { return size() * (7 * sizeof(float) + sizeof(uint8_t)); }
+
+    // Takes over a cloth made by buildGrid(width, height). Links missing
+    // from it (removed tears) start out broken.
+    void load(const Cloth &cloth, int w, int h)
+    {
+        width = w;
+        height = h;
+        size_t n = static_cast<size_t>(w) * h;
+        for (auto *v : {&x, &y, &z, &px, &py, &pz})
+            v->resize(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            const Point &p = cloth.points[i];
+            x[i] = p.pos.x;
+            y[i] = p.pos.y;
+            z[i] = p.pos.z;
+            px[i] = p.prevPos.x;
+            py[i] = p.prevPos.y;
+            pz[i] = p.prevPos.z;
+        }
+        invMass.resize(n);
+        for (size_t i = 0; i < n; i++)
+            invMass[i] = cloth.points[i].invMass;
+
+        broken.assign(n, GRID_RIGHT_BROKEN | GRID_DOWN_BROKEN);
+        for (const Link &l : cloth.links)
+        {
+            size_t a = cloth.indexOf(l.p1), b = cloth.indexOf(l.p2);
+            if (l.broken)
+                continue;
+            if (b == a + 1)
+                broken[a] &= ~GRID_RIGHT_BROKEN;
+            else if (b == a + static_cast<size_t>(w))
+                broken[a] &= ~GRID_DOWN_BROKEN;
+        }
+        if (!cloth.links.empty())
+            rest = cloth.links.front().targetDist;
+    }
+
+    sf::Vector3f position(size_t i) const { return {x[i], y[i], z[i]}; }
+
+    // Cloth::step on the grid state. Returns the number of links that
+    // snapped this frame.
+    size_t step(float time, const SimParams &params)
+    {
+        size_t snapped = 0;
+        {
+            TraceScope span("solve");
+            unsigned workers = pool ? pool->size() : 1;
+            std::vector<size_t> partial(workers, 0);
+            const size_t w = static_cast<size_t>(width);
+            const float limit = rest * params.stretchLimit;
+            for (int i = 0; i < params.iterations; i++)
+            {
+                // Colours 0 and 1: right links starting at even, then odd x, in every row
+                for (size_t parity = 0; parity < 2; parity++)
+                {
+                    forRows("solve batch", height, [&](size_t row, unsigned worker)
+                            { partial[worker] += solveRun<2>(row * w + parity, 1, (w - parity) / 2,
+                                                             GRID_RIGHT_BROKEN, limit); });
+                }
+                // Colours 2 and 3: down links from even, then odd rows
+                for (size_t parity = 0; parity < 2; parity++)
+                {
+                    size_t rows = (height - parity) / 2; // y <= height - 2
+                    forRows("solve batch", rows, [&](size_t k, unsigned worker)
+                            { partial[worker] += solveRun<1>((2 * k + parity) * w, w, w, GRID_DOWN_BROKEN,
+                                                             limit); });
+                }
+            }
+            for (size_t s : partial)
+                snapped += s;
+        }
+
+        bool aero = params.drag != 0.f || params.lift != 0.f;
+        if (aero)
+        {
+            TraceScope span("aero");
+            size_t padded = static_cast<size_t>(width + 1) * (height + 1);
+            if (ax.size() != padded)
+                for (auto *v : {&ax, &ay, &az, &bx, &by, &bz})
+                    v->assign(padded, 0.f);
+            forRows("aero", height - 1, [&](size_t row, unsigned)
+                    { aeroRow(row, params); });
+        }
+
+        {
+            TraceScope span("integrate");
+            forRows("integrate", height, [&](size_t row, unsigned)
+                    { integrateRun(row, time, params, aero); });
+        }
+        return snapped;
+    }
+
+    // Same formulation as Cloth::energy().
+    double energy(const SimParams &params) const
+    {
+        double e = 0.0;
+        for (size_t i = 0; i < size(); i++)
+        {
+            float vx = x[i] - px[i], vy = y[i] - py[i], vz = z[i] - pz[i];
+            e += 0.5 * (vx * vx + vy * vy + vz * vz) - params.gravity * y[i];
+        }
+        return e;
+    }
+
+private:
+    // Runs fn(row, worker) for rows [0, n), split across the pool if there is one.
+    template <typename F>
+    void forRows(const char *name, size_t n, F &&fn)
+    {
+        auto rows = [&](size_t begin, size_t end, unsigned worker)
+        {
+            for (size_t r = begin; r < end; r++)
+                fn(r, worker);
+        };
+        if (pool)
+            pool->parallelFor(name, n, rows);
+        else if (n > 0)
+            rows(0, n, 0);
+    }
+
+    // Link::solve for the `count` links a -> a + offset with
+    // a = first + k * STRIDE. No two of them share a point. Branch-free:
+    // broken and degenerate links get a zero correction, and pins have
+    // zero inverse mass.
+    template <size_t STRIDE>
+    size_t solveRun(size_t first, size_t offset, size_t count, uint8_t bit, float limit)
+    {
+        float *X = x.data(), *Y = y.data(), *Z = z.data();
+        const float *W = invMass.data();
+        uint8_t *mask = broken.data();
+        const float len = rest;
+
+        size_t snapped = 0;
+#pragma GCC ivdep
+        for (size_t k = 0; k < count; k++)
+        {
+            const size_t a = first + k * STRIDE, b = a + offset;
+            float ex = X[a] - X[b], ey = Y[a] - Y[b], ez = Z[a] - Z[b];
+            float dist = std::sqrt(ex * ex + ey * ey + ez * ez);
+
+            // Plain & rather than &&: both sides are cheap and it keeps the loop branch-free
+            const uint8_t m = mask[a];
+            const int live = (m & bit) == 0;
+            const int snap = live & (dist > limit);
+            mask[a] = static_cast<uint8_t>(m | (snap * bit));
+            snapped += snap;
+
+            const float wa = W[a], wb = W[b];
+            float factor = (live & !snap & (dist >= 0.1f)) ? (len - dist) / (dist * std::max(wa + wb, 1e-6f)) : 0.f;
+            float fa = factor * wa, fb = factor * wb;
+            X[a] += ex * fa;
+            Y[a] += ey * fa;
+            Z[a] += ez * fa;
+            X[b] -= ex * fb;
+            Y[b] -= ey * fb;
+            Z[b] -= ez * fb;
+        }
+        return snapped;
+    }
+
+    // triangleAero for the two triangles of every cell in row `row`.
+    void aeroRow(size_t row, const SimParams &params)
+    {
+        const size_t w = static_cast<size_t>(width), stride = w + 1;
+        const float *X = x.data(), *Y = y.data(), *Z = z.data();
+        const float *PX = px.data(), *PY = py.data(), *PZ = pz.data();
+        const uint8_t *mask = broken.data();
+        float *AX = ax.data(), *AY = ay.data(), *AZ = az.data(), *BX = bx.data(), *BY = by.data(), *BZ = bz.data();
+        const float drag = params.drag, lift = params.lift;
+        const sf::Vector3f air = params.air;
+
+#pragma GCC ivdep
+        for (size_t k = 0; k + 1 < w; k++)
+        {
+            const size_t i = row * w + k, c = (row + 1) * stride + k + 1;
+            const sf::Vector3f p0(X[i], Y[i], Z[i]), p1(X[i + 1], Y[i + 1], Z[i + 1]);
+            const sf::Vector3f p2(X[i + w], Y[i + w], Z[i + w]), p3(X[i + w + 1], Y[i + w + 1], Z[i + w + 1]);
+            const sf::Vector3f v0 = p0 - sf::Vector3f(PX[i], PY[i], PZ[i]);
+            const sf::Vector3f v1 = p1 - sf::Vector3f(PX[i + 1], PY[i + 1], PZ[i + 1]);
+            const sf::Vector3f v2 = p2 - sf::Vector3f(PX[i + w], PY[i + w], PZ[i + w]);
+            const sf::Vector3f v3 = p3 - sf::Vector3f(PX[i + w + 1], PY[i + w + 1], PZ[i + w + 1]);
+
+            // A triangle lives while both of its grid links do
+            const float liveA = static_cast<float>((mask[i] & (GRID_RIGHT_BROKEN | GRID_DOWN_BROKEN)) == 0);
+            const float liveB = static_cast<float>(((mask[i + 1] & GRID_DOWN_BROKEN) | (mask[i + w] & GRID_RIGHT_BROKEN)) == 0);
+            sf::Vector3f fa = triangleAero(p1 - p0, p2 - p0, (v0 + v1 + v2) / 3.f - air, drag, lift) * (liveA / 3.f);
+            sf::Vector3f fb = triangleAero(p3 - p1, p2 - p1, (v1 + v3 + v2) / 3.f - air, drag, lift) * (liveB / 3.f);
+            AX[c] = fa.x;
+            AY[c] = fa.y;
+            AZ[c] = fa.z;
+            BX[c] = fb.x;
+            BY[c] = fb.y;
+            BZ[c] = fb.z;
+        }
+    }
+
+    // Point::update for the points of row `row`, plus their six
+    // triangles' shares with `aero`. Pinned points keep pos == prevPos.
+    void integrateRun(size_t row, float time, const SimParams &params, bool aero)
+    {
+        const size_t first = row * width, count = width;
+        float *X = x.data() + first, *Y = y.data() + first, *Z = z.data() + first;
+        float *PX = px.data() + first, *PY = py.data() + first, *PZ = pz.data() + first;
+        const float *W = invMass.data() + first;
+        const float friction = params.airFriction, gravity = params.gravity;
+        const size_t stride = width + 1, c0 = (row + 1) * stride + 1; // Cell (0, row), padded
+
+#pragma GCC ivdep
+        for (size_t i = 0; i < count; i++)
+        {
+            float ox = X[i], oy = Y[i], oz = Z[i];
+            float fx = 0.f, fy = 0.f, fz = 0.f;
+            if (aero)
+            {
+                // A of cells (x, y), (x - 1, y), (x, y - 1); B of (x - 1, y), (x - 1, y - 1), (x, y - 1)
+                const size_t c = c0 + i;
+                fx = ax[c] + ax[c - 1] + ax[c - stride] + bx[c - 1] + bx[c - stride - 1] + bx[c - stride];
+                fy = ay[c] + ay[c - 1] + ay[c - stride] + by[c - 1] + by[c - stride - 1] + by[c - stride];
+                fz = az[c] + az[c - 1] + az[c - stride] + bz[c - 1] + bz[c - stride - 1] + bz[c - stride];
+            }
+            float nx = ox + (ox - PX[i]) * friction + fx * W[i];
+            float ny = oy + (oy - PY[i]) * friction + gravity + fy * W[i];
+            float nz = (oz + (oz - PZ[i]) * friction + std::sin(time + nx * 0.05f) * params.wind * W[i] + fz * W[i]) *
+                       params.zDamping;
+            const float m = static_cast<float>(W[i] > 0.f);
+            X[i] = ox + m * (nx - ox);
+            Y[i] = oy + m * (ny - oy);
+            Z[i] = oz + m * (nz - oz);
+            PX[i] = ox;
+            PY[i] = oy;
+            PZ[i] = oz;
+        }
+    }
+};
@@ -0,0 +1,241 @@
+/**
+ * ======================================================================================
+ * LOCK-STEP ENSEMBLE (K cloth variants in one vectorized pass)
+ * ======================================================================================
+ *
+ * When every run of a sweep shares the same topology, the K variants can be
+ * stepped together. Each particle stores all K lanes side by side:
+ *
+ *   x: [ p0.l0 p0.l1 ... p0.lK-1 | p1.l0 p1.l1 ... p1.lK-1 | ... ]
+ *          \______ one SIMD register ______/
+ *
+ * so solving link (a, b) loads K contiguous floats per coordinate from `a`
+ * and from `b`, and the per-lane gravity / friction / stretch limit live in
+ * small K-wide arrays. Tears only differ per lane, so instead of removing
+ * links the cloth keeps a per-lane `alive` mask (1 = intact, 0 = broken) and
+ * multiplies corrections by it. Everything in the lane loops is branch-free.
+ *
+ * The iteration count is shared by the whole batch (it drives the loop, not
+ * the arithmetic), so the ensemble runner groups jobs by iteration count.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include "cloth.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// One AVX-512 register of floats when available, otherwise one AVX register.
+#if defined(__AVX512F__)
+const int LOCKSTEP_LANES = 16;
+#else
+const int LOCKSTEP_LANES = 8;
+#endif
+
+template <int K>
+struct LockstepCloth
+{
+    // Interleaved lane data: element [i * K + k] is particle i of lane k.
+    std::vector<float> px, py, pz; // Current positions
+    std::vector<float> qx, qy, qz; // Previous positions
+    std::vector<float> invMass;    // Point::invMass, 0 for pinned particles (shared by all lanes)
+
+    // Shared topology: link l joins particles linkA[l] and linkB[l].
+    std::vector<uint32_t> linkA, linkB;
+    std::vector<float> rest;
+    std::vector<float> alive; // [l * K + k], per-lane broken mask
+
+    std::array<float, K> gravity{}, airFriction{}, stretchLimit{};
+    int iterations = ITERATIONS;
+
+    // Builds the same grid as Cloth::buildGrid in every lane. The topology
+    // is built on the first call (or when the size changes); later batches
+    // only reset the lanes' positions, masks and parameters.
+    void buildGrid(int width, int height, const std::array<SimParams, K> &lanes, float spacing = DISTANCE)
+    {
+        if (width != gridWidth || height != gridHeight || spacing != gridSpacing)
+        {
+            Cloth grid;
+            grid.buildGrid(width, height, spacing);
+            loadTopology(grid);
+            gridWidth = width;
+            gridHeight = height;
+            gridSpacing = spacing;
+        }
+        reset(lanes);
+    }
+
+    void load(const Cloth &cloth, const std::array<SimParams, K> &lanes)
+    {
+        loadTopology(cloth);
+        gridWidth = gridHeight = 0; // Not a buildGrid topology
+        reset(lanes);
+    }
+
+    // Puts every lane back at the start positions, all links intact.
+    void reset(const std::array<SimParams, K> &lanes)
+    {
+        size_t n = invMass.size();
+        for (auto *v : {&px, &py, &pz, &qx, &qy, &qz})
+            v->resize(n * K);
+        for (size_t i = 0; i < n; i++)
+        {
+            for (int k = 0; k < K; k++)
+            {
+                px[i * K + k] = startPos[i].x;
+                py[i * K + k] = startPos[i].y;
+                pz[i * K + k] = startPos[i].z;
+                qx[i * K + k] = startPrev[i].x;
+                qy[i * K + k] = startPrev[i].y;
+                qz[i * K + k] = startPrev[i].z;
+            }
+        }
+        alive.assign(rest.size() * K, 1.f);
+
+        for (int k = 0; k < K; k++)
+        {
+            gravity[k] = lanes[k].gravity;
+            airFriction[k] = lanes[k].airFriction;
+            stretchLimit[k] = lanes[k].stretchLimit;
+        }
+        iterations = lanes[0].iterations;
+    }
+
+    // One frame for all lanes: `iterations` solver sweeps, then integration.
+    // Adds the links that snapped in each lane to `tears`.
+    void step(float time, std::array<size_t, K> &tears)
+    {
+        std::array<float, K> snapped{};
+        for (int i = 0; i < iterations; i++)
+            solveAll(snapped);
+        for (int k = 0; k < K; k++)
+            tears[k] += static_cast<size_t>(snapped[k]);
+
+        updateAll(time);
+    }
+
+    // Same formulation as Cloth::energy(), one value per lane.
+    std::array<double, K> energy() const
+    {
+        std::array<double, K> e{};
+        for (size_t i = 0; i < invMass.size(); i++)
+        {
+            for (int k = 0; k < K; k++)
+            {
+                size_t j = i * K + k;
+                float vx = px[j] - qx[j], vy = py[j] - qy[j], vz = pz[j] - qz[j];
+                e[k] += 0.5 * (vx * vx + vy * vy + vz * vz) - gravity[k] * py[j];
+            }
+        }
+        return e;
+    }
+
+private:
+    // Start state shared by every batch (one entry per particle)
+    std::vector<sf::Vector3f> startPos, startPrev;
+    int gridWidth = 0, gridHeight = 0;
+    float gridSpacing = 0.f;
+
+    void loadTopology(const Cloth &cloth)
+    {
+        size_t n = cloth.points.size();
+        invMass.resize(n);
+        startPos.resize(n);
+        startPrev.resize(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            invMass[i] = cloth.points[i].invMass;
+            startPos[i] = cloth.points[i].pos;
+            startPrev[i] = cloth.points[i].prevPos;
+        }
+
+        size_t m = cloth.links.size();
+        linkA.resize(m);
+        linkB.resize(m);
+        rest.resize(m);
+        for (size_t l = 0; l < m; l++)
+        {
+            linkA[l] = static_cast<uint32_t>(cloth.links[l].p1 - cloth.points.data());
+            linkB[l] = static_cast<uint32_t>(cloth.links[l].p2 - cloth.points.data());
+            rest[l] = cloth.links[l].targetDist;
+        }
+    }
+
+    // Link::solve for K lanes at once. The lane loops index the shared
+    // arrays directly (rather than through per-link pointers) so GCC and
+    // Clang turn them into straight SIMD; `ivdep` tells them that lanes of
+    // particle a and particle b never overlap. Needs -fno-math-errno, or
+    // std::sqrt keeps a scalar fallback branch that blocks vectorization.
+    void solveAll(std::array<float, K> &snapped)
+    {
+        for (size_t l = 0; l < rest.size(); l++)
+        {
+            const size_t a = size_t(linkA[l]) * K, b = size_t(linkB[l]) * K, o = l * K;
+            const float target = rest[l];
+            const float wa = invMass[linkA[l]], wb = invMass[linkB[l]];
+            const float share = 1.f / std::max(wa + wb, 1e-6f);
+            const float ma = wa * share, mb = wb * share;
+
+#pragma GCC ivdep
+            for (int k = 0; k < K; k++)
+            {
+                float dx = px[a + k] - px[b + k], dy = py[a + k] - py[b + k], dz = pz[a + k] - pz[b + k];
+                float dist = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+                // Tear: clear the lane's alive bit (counted once, on the transition)
+                float ok = alive[o + k];
+                float tearing = ok * static_cast<float>(dist > target * stretchLimit[k]);
+                snapped[k] += tearing;
+                ok -= tearing;
+                alive[o + k] = ok;
+
+                // Broken links and near-zero lengths apply no correction
+                float active = ok * static_cast<float>(dist >= 0.1f);
+                float factor = active * (target - dist) / std::max(dist, 0.1f);
+
+                px[a + k] += dx * factor * ma;
+                py[a + k] += dy * factor * ma;
+                pz[a + k] += dz * factor * ma;
+                px[b + k] -= dx * factor * mb;
+                py[b + k] -= dy * factor * mb;
+                pz[b + k] -= dz * factor * mb;
+            }
+        }
+    }
+
+    // Point::update for K lanes at once. The wind's std::sin only
+    // vectorizes with a vector math library (-ffast-math on glibc).
+    void updateAll(float time)
+    {
+        for (size_t i = 0; i < invMass.size(); i++)
+        {
+            const float w = invMass[i], m = static_cast<float>(w > 0.f);
+            const size_t o = i * K;
+
+#pragma GCC ivdep
+            for (int k = 0; k < K; k++)
+            {
+                float vx = (px[o + k] - qx[o + k]) * airFriction[k];
+                float vy = (py[o + k] - qy[o + k]) * airFriction[k];
+                float vz = (pz[o + k] - qz[o + k]) * airFriction[k];
+
+                // Pinned particles keep pos == prevPos, so copying is harmless
+                qx[o + k] = px[o + k];
+                qy[o + k] = py[o + k];
+                qz[o + k] = pz[o + k];
+
+                float nx = px[o + k] + vx;
+                float ny = py[o + k] + vy + gravity[k];
+                float nz = (pz[o + k] + vz + std::sin(time + nx * 0.05f) * WIND * w) * Z_DAMPING;
+
+                px[o + k] += m * (nx - px[o + k]);
+                py[o + k] += m * (ny - py[o + k]);
+                pz[o + k] += m * (nz - pz[o + k]);
+            }
+        }
+    }
+};
+
+using LockstepEnsemble = LockstepCloth<LOCKSTEP_LANES>;
@@ -27,123 +27,25 @@
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <cctype>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
-// --- Configuration Constants ---
-const int WIDTH = 70;        // Number of points horizontally
-const int HEIGHT = 45;       // Number of points vertically
-const float DISTANCE = 18.f; // Resting distance between points
-const float GRAVITY = 0.35f; // Downward force per frame
-const float AIR_FRICTION = 0.98f; // Velocity damping factor. Lower value = more drag.
-const float STRETCH_LIMIT = 5.0f; // Multiplier for link breaking threshold
-
-/**
- * ------------------------------------------------------------------
- * STRUCT: Point
- * Represents a single particle in the cloth mesh.
- * ------------------------------------------------------------------
- *
- * VERLET INTEGRATION EXPLAINED:
- * Instead of storing velocity explicitly, we store the previous position.
- * Velocity is implicitly derived:
- *
- * PrevPos        CurrentPos        NextPos
- * O ―――――――――――> O ―――――――――――> O
- * ^                 ^
- * (Pos - Prev)      Apply this delta
- * is the vector     to current pos
- *
- * ------------------------------------------------------------------
- */
-struct Point
-{
-    sf::Vector3f pos;       // Current Position (x, y, z)
-    sf::Vector3f prevPos;   // Position in the previous frame
-    bool locked = false;    // If true, the point is pinned (static)
-    bool isGrabbed = false; // If true, currently held by mouse
-
-    Point(float x, float y, float z) : pos(x, y, z), prevPos(x, y, z) {}
-
-    void update(float time)
-    {
-        if (locked || isGrabbed)
-            return;
-
-        // 1. Calculate Velocity (Verlet)
-        sf::Vector3f vel = (pos - prevPos) * AIR_FRICTION;
-
-        // 2. Update Positions
-        prevPos = pos;
-        pos += vel;
-        pos.y += GRAVITY; // Apply gravity force
-
-        // 3. Simulate Wind (Sine wave on Z-axis)
-        //    Adds a subtle oscillation to make it look alive.
-        pos.z += std::sin(time + pos.x * 0.05f) * 0.15f;
-        pos.z *= 0.99f; // Damping on Z to prevent infinite oscillation
-    }
-};
-
-/**
- * ------------------------------------------------------------------
- * STRUCT: Link
- * Represents the constraint (stick) between two points.
- * ------------------------------------------------------------------
- *
- * CONSTRAINT SOLVING:
- * We want the distance (d) between P1 and P2 to always equal targetDist.
- * If (d != targetDist), we push/pull P1 and P2 to fix it.
- *
- * P1 <---- (correction) ----> P2
- *
- * ------------------------------------------------------------------
- */
-struct Link
-{
-    Point *p1;
-    Point *p2;
-    float targetDist;    // The resting length of the link
-    bool broken = false; // True if the link has been cut or snapped
-
-    Link(Point &a, Point &b) : p1(&a), p2(&b)
-    {
-        sf::Vector3f d = p1->pos - p2->pos;
-        targetDist = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
-    }
-
-    void solve()
-    {
-        if (broken)
-            return;
-
-        sf::Vector3f diff = p1->pos - p2->pos;
-        float dist = std::sqrt(diff.x * diff.x + diff.y * diff.y + diff.z * diff.z);
-
-        // --- TEAR LOGIC ---
-        // If stretched too far (5x length), the link snaps.
-        if (dist > targetDist * STRETCH_LIMIT)
-        {
-            broken = true;
-            return;
-        }
-
-        // Avoid division by zero
-        if (dist < 0.1f)
-            return;
-
-        // Calculate the correction factor
-        // (Difference between current dist and target dist)
-        float factor = (targetDist - dist) / dist * 0.5f; // 0.5 because each point moves half the error
-        sf::Vector3f offset = diff * factor;
-
-        // Apply correction if points are not locked/grabbed
-        if (!p1->locked && !p1->isGrabbed)
-            p1->pos += offset;
-        if (!p2->locked && !p2->isGrabbed)
-            p2->pos -= offset;
-    }
-};
+#include "cloth.hpp"
+#include "anchors.hpp"
+#include "bench.hpp"
+#include "coloring.hpp"
+#include "convergence.hpp"
+#include "ensemble.hpp"
+#include "framegraph.hpp"
+#include "governor.hpp"
+#include "grab.hpp"
+#include "mesh.hpp"
+#include "spatial.hpp"
+#include "telemetry.hpp"
+#include "trace.hpp"
 
 /**
  * ------------------------------------------------------------------
@@ -181,6 +83,41 @@ sf::Vector2f project(sf::Vector3f p, sf::Vector2u winSize)
     };
 }
 
+// Inverse of project() for a point at depth z.
+sf::Vector3f unproject(sf::Vector2f screen, float z, sf::Vector2u winSize)
+{
+    float focalLength = 900.f;
+    float perspective = focalLength / (focalLength + z + 500.f);
+    return {(screen.x - winSize.x / 2.f) / perspective, (screen.y - winSize.y / 10.f) / perspective, z};
+}
+
+/**
+ * ------------------------------------------------------------------
+ * FUNCTION: forPointsNear
+ * Calls fn(index, distance) for every point projected within `radius`
+ * pixels of `center`. Only the grid cells under the circle are visited:
+ * the circle is un-projected at the nearest and farthest depths in the
+ * grid, and the rectangle around both holds every candidate.
+ * ------------------------------------------------------------------
+ */
+template <typename F>
+void forPointsNear(const PageVector<Point> &points, const SpatialGrid &grid, sf::Vector2f center, float radius,
+                   sf::Vector2u winSize, F &&fn)
+{
+    sf::Vector2f lo(center.x - radius, center.y - radius), hi(center.x + radius, center.y + radius);
+    sf::Vector3f a = unproject(lo, grid.minZ, winSize), b = unproject(hi, grid.minZ, winSize);
+    sf::Vector3f c = unproject(lo, grid.maxZ, winSize), d = unproject(hi, grid.maxZ, winSize);
+    grid.query(std::min({a.x, b.x, c.x, d.x}), std::min({a.y, b.y, c.y, d.y}), std::max({a.x, b.x, c.x, d.x}),
+               std::max({a.y, b.y, c.y, d.y}), [&](uint32_t i)
+               {
+                   sf::Vector2f proj = project(points[i].pos, winSize);
+                   float dx = proj.x - center.x;
+                   float dy = proj.y - center.y;
+                   float dist = std::sqrt(dx * dx + dy * dy);
+                   if (dist <= radius)
+                       fn(i, dist); });
+}
+
 /**
  * ------------------------------------------------------------------
  * FUNCTION: Intersects
@@ -200,85 +137,308 @@ bool intersects(sf::Vector2f a, sf::Vector2f b, sf::Vector2f c, sf::Vector2f d)
 // ======================================================================================
 // MAIN FUNCTION
 // ======================================================================================
-int main()
+int main(int argc, char **argv)
 {
+    // Headless parameter sweep: ./fabric --ensemble --gravity 0.2,0.35 ...
+    if (argc > 1 && std::strcmp(argv[1], "--ensemble") == 0)
+    {
+        EnsembleConfig cfg;
+        if (!parseEnsembleArgs(argc - 2, argv + 2, cfg))
+            return 1;
+
+        std::vector<EnsembleResult> results = runEnsemble(cfg);
+        if (!writeEnsembleCsv(cfg.outPath, cfg, results))
+        {
+            std::cerr << "Could not write " << cfg.outPath << "\n";
+            return 1;
+        }
+        std::cout << "Wrote " << results.size() << " runs to " << cfg.outPath << "\n";
+        return 0;
+    }
+
+    // Scalability benchmark: ./fabric --bench --sizes 70x45,1024x1024 ...
+    if (argc > 1 && std::strcmp(argv[1], "--bench") == 0)
+    {
+        BenchConfig cfg;
+        if (!parseBenchArgs(argc - 2, argv + 2, cfg))
+            return 1;
+        return runBench(cfg);
+    }
+
+    // Parallel solvers against the serial one: ./fabric --converge --solvers chaotic ...
+    if (argc > 1 && std::strcmp(argv[1], "--converge") == 0)
+    {
+        ConvergeConfig cfg;
+        if (!parseConvergeArgs(argc - 2, argv + 2, cfg))
+            return 1;
+        return runConverge(cfg);
+    }
+
+    // Interactive options
+    TelemetryWriter telemetry;
+    Tracer &tracer = Tracer::instance();
+    tracer.setThreadName("main");
+    std::string traceFile = "fabric_trace.json";
+    uint64_t traceFrames = 0; // Dump automatically after this many frames (0 = only on T)
+    bool dumpTrace = false;
+    uint64_t profileEvery = 0; // Print the phase profile every N frames (0 = off)
+    SimParams params;
+    std::string meshPath; // Empty = the default grid
+    std::string anchorPath; // Keyframed pin motion (anchors.hpp)
+    PinPattern pinPattern = PinPattern::Top;
+    int pinSpacing = PIN_SPACING;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    float frameBudget = 0.f; // Governor target in ms (0 = fixed quality)
+    int minIterations = 2;
+    float hemMass = 1.f; // Mass of the bottom row (1 = uniform cloth)
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--telemetry") == 0)
+        {
+            // Optional shared-memory name, e.g. --telemetry /my_channel
+            const char *name = (i + 1 < argc && argv[i + 1][0] == '/') ? argv[++i] : TELEMETRY_DEFAULT_NAME;
+            if (!telemetry.open(name))
+                std::cerr << "Could not open telemetry channel " << name << "\n";
+        }
+        else if (std::strcmp(argv[i], "--trace-frames") == 0 && i + 1 < argc)
+        {
+            traceFrames = std::strtoull(argv[++i], nullptr, 10);
+            tracer.setEnabled(traceFrames > 0);
+        }
+        else if (std::strcmp(argv[i], "--profile") == 0)
+        {
+            // Optional report interval, e.g. --profile 300
+            profileEvery = (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])))
+                               ? std::strtoull(argv[++i], nullptr, 10)
+                               : 120;
+            Profiler::instance().enable();
+        }
+        else if (std::strcmp(argv[i], "--solver") == 0 && i + 1 < argc)
+        {
+            if (!parseSolverMode(argv[++i], params.solver))
+            {
+                std::cerr << "Unknown solver " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--tear") == 0 && i + 1 < argc)
+        {
+            if (!parseTearMode(argv[++i], params.tear))
+            {
+                std::cerr << "Unknown tear mode " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--pins") == 0 && i + 1 < argc)
+        {
+            if (!parsePinPattern(argv[++i], pinPattern))
+            {
+                std::cerr << "Unknown pin pattern " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--pin-spacing") == 0 && i + 1 < argc)
+            pinSpacing = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--anchors") == 0 && i + 1 < argc)
+            anchorPath = argv[++i];
+        else if (std::strcmp(argv[i], "--mesh") == 0 && i + 1 < argc)
+            meshPath = argv[++i];
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        else if (std::strcmp(argv[i], "--substeps") == 0 && i + 1 < argc)
+            params.substeps = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+            params.iterations = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--hem-mass") == 0 && i + 1 < argc)
+            hemMass = std::max(0.01f, static_cast<float>(std::atof(argv[++i])));
+        else if (std::strcmp(argv[i], "--drag") == 0 && i + 1 < argc)
+            params.drag = std::max(0.f, static_cast<float>(std::atof(argv[++i])));
+        else if (std::strcmp(argv[i], "--lift") == 0 && i + 1 < argc)
+            params.lift = static_cast<float>(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--air") == 0 && i + 1 < argc)
+        {
+            if (std::sscanf(argv[++i], "%f,%f,%f", &params.air.x, &params.air.y, &params.air.z) != 3)
+            {
+                std::cerr << "--air takes x,y,z\n";
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--strain-limit") == 0 && i + 1 < argc)
+        {
+            if (std::sscanf(argv[++i], "%f,%f", &params.strainMin, &params.strainMax) != 2 ||
+                params.strainMin < 0.f || params.strainMax < std::max(params.strainMin, 1.f))
+            {
+                std::cerr << "--strain-limit takes min,max with 0 <= min and 1 <= max\n";
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--tile-threshold") == 0 && i + 1 < argc)
+            params.tileThreshold = std::max(0.f, static_cast<float>(std::atof(argv[++i])));
+        else if (std::strcmp(argv[i], "--frame-budget") == 0 && i + 1 < argc)
+            frameBudget = std::max(0.f, static_cast<float>(std::atof(argv[++i])));
+        else if (std::strcmp(argv[i], "--min-iterations") == 0 && i + 1 < argc)
+            minIterations = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--trace-file") == 0 && i + 1 < argc)
+            traceFile = argv[++i];
+        else
+        {
+            std::cerr << "Unknown option " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
     // 1. Setup Window
     sf::RenderWindow window(sf::VideoMode(1400, 900), "SFML 3D Cloth Simulation");
     window.setFramerateLimit(60);
 
     sf::Clock clock;
-    std::vector<Point> points;
-    std::vector<Link> links;
-
-    // Interaction State
-    Point *grabbedPoint = nullptr;
-    sf::Vector2f lastMousePos;
-
-    // 2. Initialize Points (Grid)
-    //    Loops Y then X to create the mesh
-    for (int y = 0; y < HEIGHT; y++)
+    sf::Clock frameClock;
+    uint64_t frame = 0;
+    float tearRate = 0.f;
+
+    // 2. Build the cloth (grid of points joined by links, top row pinned,
+    //    or the mesh given with --mesh)
+    WorkerPool pool(params.solver == SolverMode::Serial ? 1 : threads);
+    Cloth cloth;
+    cloth.pool = &pool;
+    if (params.tear == TearMode::Split)
+        cloth.splitReserve = SPLIT_RESERVE;
+    cloth.pinPattern = pinPattern;
+    cloth.pinSpacing = pinSpacing;
+    if (meshPath.empty())
+        cloth.buildGrid(WIDTH, HEIGHT);
+    else
     {
-        for (int x = 0; x < WIDTH; x++)
+        sf::Clock loadClock;
+        MeshData mesh;
+        std::string error;
+        if (!loadObj(meshPath, mesh, error))
         {
-            // Center the cloth horizontally
-            points.emplace_back(x * DISTANCE - (WIDTH * DISTANCE) / 2.f, y * DISTANCE, 0.f);
-
-            // Pin the top row so the cloth hangs
-            if (y == 0)
-                points.back().locked = true;
+            std::cerr << error << "\n";
+            return 1;
         }
+        if (!buildClothFromMesh(cloth, mesh, &pool) && params.solver == SolverMode::Colored)
+            std::cerr << "Mesh vertex degree too high to colour the links; solving serially\n";
+        std::cout << "Loaded " << meshPath << ": " << cloth.points.size() << " points, " << cloth.links.size()
+                  << " links, " << cloth.batchEnd.size() << " colours in " << loadClock.getElapsedTime().asMilliseconds()
+                  << " ms\n";
     }
-
-    // 3. Initialize Links (Connections)
-    //    Connects right (x+1) and down (y+1)
-    for (int y = 0; y < HEIGHT; y++)
+    if (!anchorPath.empty())
     {
-        for (int x = 0; x < WIDTH; x++)
+        std::string error;
+        if (!loadAnchors(anchorPath, cloth, error))
         {
-            if (x < WIDTH - 1) // Link to Right
-                links.emplace_back(points[y * WIDTH + x], points[y * WIDTH + x + 1]);
-
-            if (y < HEIGHT - 1) // Link Down
-                links.emplace_back(points[y * WIDTH + x], points[(y + 1) * WIDTH + x]);
+            std::cerr << error << "\n";
+            return 1;
         }
     }
+    if (hemMass != 1.f)
+        cloth.setHemMass(hemMass);
+    PageVector<Point> &points = cloth.points;
+    PageVector<Link> &links = cloth.links;
 
-    // 4. Main Game Loop
-    while (window.isOpen())
+    // Interaction State
+    Point *grabbedPoint = nullptr;
+    SpatialGrid grid;  // Rebuilt each frame while no grab is held
+    bool gridCurrent = false;
+    BrushGrab brush;   // Shift + left click
+    float brushRadius = BRUSH_RADIUS;
+    sf::Vector2f lastMousePos;
+
+    // Per-frame state the tasks share
+    float elapsed = 0.f;
+    sf::Vector2u winSize = window.getSize();
+    sf::Vector2f mPos;
+    size_t tears = 0;
+    std::vector<sf::Vector2f> screen; // Projected points
+    sf::VertexArray va(sf::Lines);
+    TelemetryRecord record{};         // Last frame's, published during this one
+    bool recordPending = false;
+    int renderInterval = 1;           // Rebuild the vertices every Nth frame
+    float displaySeconds = 0.f;       // Time in display(), incl. the frame-rate limiter
+
+    // Frame-time governor (--frame-budget): gives up solver iterations
+    // first, then substeps, then vertex rebuilds
+    FrameGovernor governor;
+    if (frameBudget > 0.f)
     {
-        float elapsed = clock.getElapsedTime().asSeconds();
-        sf::Vector2u winSize = window.getSize();
-        sf::Vector2f mPos = sf::Vector2f(sf::Mouse::getPosition(window));
+        governor.targetMs = frameBudget;
+        governor.addKnob("iterations", params.iterations, params.iterations,
+                         std::min(minIterations, params.iterations));
+        governor.addKnob("substeps", params.substeps, params.substeps, 1);
+        governor.addKnob("render interval", renderInterval, 1, 3);
+    }
+
+    // 3. The frame as a task graph (framegraph.hpp). Each phase declares
+    //    what it reads and writes; independent ones share the pool.
+    FrameGraph graph;
 
-        // --- Event Polling ---
+    // --- Telemetry (the previous frame's record) ---
+    graph.add("telemetry", FRAME_RECORD, 0, [&]()
+              {
+                  telemetry.publish(record);
+                  recordPending = false; })
+        .active = [&]() { return recordPending; };
+
+    // --- Event Polling ---
+    graph.add("events", FRAME_POSITIONS | FRAME_GRAB_INDEX, FRAME_INPUT | FRAME_PINS | FRAME_WINDOW, [&]()
+              {
         sf::Event event;
         while (window.pollEvent(event))
         {
             if (event.type == sf::Event::Closed)
                 window.close();
 
+            // T: start recording a trace, or dump the one being recorded
+            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::T)
+            {
+                if (!tracer.isEnabled())
+                {
+                    tracer.setEnabled(true);
+                    std::cout << "Tracing... press T again to write " << traceFile << "\n";
+                }
+                else
+                    dumpTrace = true;
+            }
+
+            // Mouse wheel: brush size
+            if (event.type == sf::Event::MouseWheelScrolled)
+                brushRadius = std::max(10.f, brushRadius + event.mouseWheelScroll.delta * 10.f);
+
             // Handle Mouse Click (Grabbing)
             if (event.type == sf::Event::MouseButtonPressed)
             {
                 if (event.mouseButton.button == sf::Mouse::Left)
                 {
-                    // Find the nearest point to the mouse cursor
-                    float minDist = 50.f; // interaction radius
-                    for (auto &p : points)
+                    if (!gridCurrent)
+                        grid.build(points); // A grab ended earlier in this event batch
+                    bool brushing = sf::Keyboard::isKeyPressed(sf::Keyboard::LShift) ||
+                                    sf::Keyboard::isKeyPressed(sf::Keyboard::RShift);
+
+                    // Find the nearest free point to the mouse cursor
+                    float minDist = brushing ? brushRadius : 50.f; // interaction radius
+                    uint32_t nearest = 0;
+                    forPointsNear(points, grid, mPos, minDist, winSize, [&](uint32_t i, float d)
+                                  {
+                                      if (d < minDist && !cloth.isPinned(i))
+                                      {
+                                          minDist = d;
+                                          nearest = i;
+                                          grabbedPoint = &points[i];
+                                      } });
+
+                    if (grabbedPoint && brushing)
                     {
-                        sf::Vector2f proj = project(p.pos, winSize);
-                        float dx = proj.x - mPos.x;
-                        float dy = proj.y - mPos.y;
-                        float d = std::sqrt(dx * dx + dy * dy);
-
-                        if (d < minDist && !p.locked)
-                        {
-                            minDist = d;
-                            grabbedPoint = &p;
-                        }
+                        // Capture the whole circle around it, anchored at its depth
+                        brush.anchorZ = grabbedPoint->pos.z;
+                        sf::Vector3f anchor = unproject(mPos, brush.anchorZ, winSize);
+                        forPointsNear(points, grid, mPos, brushRadius, winSize, [&](uint32_t i, float d)
+                                      {
+                                          if (!cloth.isPinned(i))
+                                              brush.add(i, points[i].pos - anchor, d, brushRadius); });
                     }
-                    if (grabbedPoint)
-                        grabbedPoint->isGrabbed = true;
+                    else if (grabbedPoint)
+                        cloth.pin(nearest);
                 }
             }
 
@@ -287,92 +447,157 @@ int main()
             {
                 if (event.mouseButton.button == sf::Mouse::Left)
                 {
-                    if (grabbedPoint)
-                    {
-                        grabbedPoint->isGrabbed = false;
-                        grabbedPoint = nullptr;
-                    }
+                    if (grabbedPoint && !brush.active())
+                        cloth.unpin(static_cast<uint32_t>(cloth.indexOf(grabbedPoint)));
+                    grabbedPoint = nullptr;
+                    brush.clear();
+                    gridCurrent = false;
                 }
             }
-        }
-
-        // --- Logic: Dragging Points ---
-        if (grabbedPoint)
+        } })
+        .mainThread = true;
+
+    // --- Logic: Dragging Points ---
+    graph.add("grab", FRAME_INPUT, FRAME_POSITIONS | FRAME_PINS, [&]()
+              {
+        if (brush.active())
+            brush.drag(cloth, unproject(mPos, brush.anchorZ, winSize));
+        else
         {
-            // Reverse projection to move 3D point with 2D mouse
-            float focalLength = 900.f;
-            float perspective = focalLength / (focalLength + grabbedPoint->pos.z + 500.f);
-
-            grabbedPoint->pos.x = (mPos.x - winSize.x / 2.f) / perspective;
-            grabbedPoint->pos.y = (mPos.y - winSize.y / 10.f) / perspective;
-
-            // Reset velocity when dragging (prevent slingshot effect)
-            grabbedPoint->prevPos = grabbedPoint->pos;
-        }
-
-        // --- Logic: Cutting Links (Right Click) ---
-        if (sf::Mouse::isButtonPressed(sf::Mouse::Right))
+            // Reverse projection to move 3D point with 2D mouse. The grabbed
+            // point is a pin following the mouse (its velocity is reset every
+            // frame, which prevents a slingshot effect)
+            cloth.pin(static_cast<uint32_t>(cloth.indexOf(grabbedPoint)),
+                      unproject(mPos, grabbedPoint->pos.z, winSize));
+        } })
+        .active = [&]() { return brush.active() || grabbedPoint; };
+
+    // --- Logic: Cutting Links (Right Click) ---
+    graph.add("cut", FRAME_POSITIONS | FRAME_INPUT, FRAME_TOPOLOGY, [&]()
+              {
+        for (size_t i = 0; i < links.size(); i++)
         {
-            for (auto &l : links)
-            {
-                sf::Vector2f p1 = project(l.p1->pos, winSize);
-                sf::Vector2f p2 = project(l.p2->pos, winSize);
+            sf::Vector2f p1 = project(links[i].p1->pos, winSize);
+            sf::Vector2f p2 = project(links[i].p2->pos, winSize);
 
-                // If the mouse trail intersects the link line, break it
-                if (intersects(lastMousePos, mPos, p1, p2))
-                {
-                    l.broken = true;
-                }
+            // If the mouse trail intersects the link line, break it
+            if (intersects(lastMousePos, mPos, p1, p2))
+            {
+                cloth.cut(i);
             }
-        }
-
-        // --- Logic: Physics Solver ---
-        // Iterate multiple times per frame for stability (stiffer cloth)
-        // 1 iteration = rubbery/stretchy
-        // 8 iterations = rigid cloth
-        for (int i = 0; i < 8; i++)
-        {
-            for (auto &l : links)
-                l.solve();
-        }
+        } })
+        .active = []() { return sf::Mouse::isButtonPressed(sf::Mouse::Right); };
+
+    // --- Logic: Physics (solve, remove broken links, integrate) ---
+    graph.add("step", 0, FRAME_POSITIONS | FRAME_TOPOLOGY | FRAME_PINS | FRAME_STATS,
+              [&]() { tears = cloth.step(elapsed * 1.5f, params); });
+
+    // Keep the parallel batches balanced (reorders links, so it runs
+    // beside the projection, which only reads positions)
+    ColorFrontier frontier;
+    graph.add("colors", FRAME_STATS, FRAME_TOPOLOGY, [&]() { maintainColors(cloth, frontier); }).active = [&]()
+    { return tears > 0; };
+
+    // Index the settled positions for the next press while grabbing is
+    // armed (nothing held), so a press only queries the cells under it.
+    // Positions do not change between here and the next frame's events
+    graph.add("grab index", FRAME_POSITIONS, FRAME_GRAB_INDEX, [&]()
+              {
+                  grid.build(points);
+                  gridCurrent = true; })
+        .active = [&]() { return !grabbedPoint && !brush.active(); };
+
+    // --- Rendering ---
+    auto renderFrame = [&]() { return frame % renderInterval == 0; };
+    graph.add("project", FRAME_POSITIONS, FRAME_PROJECTIONS, [&]()
+              {
+        screen.resize(points.size());
+        pool.parallelFor("project", points.size(), [&](size_t begin, size_t end, unsigned)
+                         {
+                             for (size_t i = begin; i < end; i++)
+                                 screen[i] = project(points[i].pos, winSize); }); })
+        .active = renderFrame;
+
+    // Use VertexArray for high performance rendering of many lines
+    graph.add("vertices", FRAME_PROJECTIONS | FRAME_POSITIONS | FRAME_TOPOLOGY | FRAME_INPUT, FRAME_VERTICES, [&]()
+              {
+        va.resize(2 * links.size());
+        pool.parallelFor("vertices", links.size(), [&](size_t begin, size_t end, unsigned)
+                         {
+            for (size_t i = begin; i < end; i++)
+            {
+                const Link &l = links[i];
 
-        // Remove broken links from the vector efficiently
-        links.erase(std::remove_if(links.begin(), links.end(),
-                                   [](const Link &l)
-                                   { return l.broken; }),
-                    links.end());
+                // Depth Shading:
+                // Calculate color based on Z-depth (closer = brighter, further = darker)
+                float depth = std::max(0.f, std::min(1.f, (l.p1->pos.z + 100.f) / 400.f));
+                std::uint8_t colorVal = static_cast<std::uint8_t>(255 * (1.0f - depth));
 
-        // Update individual point physics (gravity, wind)
-        for (auto &p : points)
-            p.update(elapsed * 1.5f);
+                // Set color (Yellow if grabbed, Blue-ish otherwise)
+                sf::Color col = l.p1 == grabbedPoint ? sf::Color::Yellow : sf::Color(50, colorVal, 255);
 
-        lastMousePos = mPos;
+                va[2 * i] = sf::Vertex(screen[cloth.indexOf(l.p1)], col);
+                va[2 * i + 1] = sf::Vertex(screen[cloth.indexOf(l.p2)], col);
+            } }); })
+        .active = renderFrame;
 
-        // --- Rendering ---
+    graph.add("draw", FRAME_VERTICES, FRAME_WINDOW, [&]()
+              {
         window.clear(sf::Color(10, 10, 15)); // Dark Blue/Grey background
+        window.draw(va);
+        sf::Clock displayClock;
+        window.display();
+        displaySeconds = displayClock.getElapsedTime().asSeconds(); })
+        .mainThread = true;
 
-        // Use VertexArray for high performance rendering of many lines
-        sf::VertexArray va(sf::Lines);
-        for (const auto &l : links)
-        {
-            sf::Vector2f v1 = project(l.p1->pos, winSize);
-            sf::Vector2f v2 = project(l.p2->pos, winSize);
-
-            // Depth Shading:
-            // Calculate color based on Z-depth (closer = brighter, further = darker)
-            float depth = std::max(0.f, std::min(1.f, (l.p1->pos.z + 100.f) / 400.f));
-            std::uint8_t colorVal = static_cast<std::uint8_t>(255 * (1.0f - depth));
+    // 4. Main Game Loop
+    while (window.isOpen())
+    {
+        TraceScope frameSpan("frame");
+        elapsed = clock.getElapsedTime().asSeconds();
+        winSize = window.getSize();
+        mPos = sf::Vector2f(sf::Mouse::getPosition(window));
 
-            // Set color (Yellow if grabbed, Blue-ish otherwise)
-            sf::Color col = l.p1->isGrabbed ? sf::Color::Yellow : sf::Color(50, colorVal, 255);
+        graph.run(pool);
+        lastMousePos = mPos;
 
-            va.append(sf::Vertex(v1, col));
-            va.append(sf::Vertex(v2, col));
+        // --- Telemetry record (end of frame, published during the next) ---
+        float frameSeconds = frameClock.restart().asSeconds();
+        if (frameBudget > 0.f)
+            governor.update((frameSeconds - displaySeconds) * 1000.f);
+        if (telemetry.isOpen())
+        {
+            // Exponential moving average over roughly one second of frames
+            float instantRate = frameSeconds > 0.f ? tears / frameSeconds : 0.f;
+            tearRate += (instantRate - tearRate) * std::min(1.f, frameSeconds);
+
+            record = TelemetryRecord{};
+            record.frame = frame;
+            record.frameMillis = frameSeconds * 1000.f;
+            record.residual = static_cast<float>(cloth.residual);
+            record.liveLinks = static_cast<uint32_t>(links.size());
+            record.tears = static_cast<uint32_t>(tears);
+            record.tearRate = tearRate;
+            recordPending = true;
         }
 
-        window.draw(va);
-        window.display();
+        // --- Phase profile (--profile) ---
+        if (profileEvery > 0 && (frame + 1) % profileEvery == 0)
+            Profiler::instance().report(profileEvery, links.size());
+
+        // --- Trace dump (T key or --trace-frames) ---
+        if (dumpTrace || (traceFrames > 0 && frame + 1 == traceFrames))
+        {
+            if (tracer.dump(traceFile))
+                std::cout << "Wrote trace to " << traceFile << "\n";
+            else
+                std::cerr << "Could not write " << traceFile << "\n";
+            dumpTrace = false;
+        }
+        frame++;
     }
+    if (recordPending)
+        telemetry.publish(record);
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,188 @@
+/**
+ * ======================================================================================
+ * PAGE-AWARE ALLOCATION (Huge pages and NUMA first touch for the big arrays)
+ * ======================================================================================
+ *
+ * The point and link arrays of a large cloth are hundreds of MB. Two things
+ * about where that memory lives matter to the solver:
+ *
+ *   TLB reach    With 4 KB pages a 1 GB array needs 262144 translations;
+ *                2 MB huge pages cut that to 512, so the random-ish link
+ *                accesses stop missing the TLB.
+ *   NUMA node    Linux places a page on the node of the thread that first
+ *                writes it. If one thread fills the arrays, every page
+ *                sits on its socket and the other socket's workers read
+ *                remotely.
+ *
+ * PageAllocator maps allocations of LARGE_ALLOCATION bytes or more
+ * directly, 2 MB aligned, with the process-wide PagePolicy:
+ *
+ *   default      plain pages (whatever the system's THP setting does)
+ *   thp          madvise(MADV_HUGEPAGE): transparent huge pages
+ *   huge         MAP_HUGETLB from the reserved pool (vm.nr_hugepages),
+ *                falling back to thp if the pool is empty
+ *
+ * and leaves the pages untouched. firstTouch() then faults them in from
+ * the worker pool with the same static split as WorkerPool::parallelFor,
+ * so each page lands on the node of the worker that will process it
+ * (stable only when the workers are pinned, WorkerPool::pinThreads).
+ * Smaller allocations go through operator new. Non-Linux builds always do.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include "parallel.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+const size_t LARGE_ALLOCATION = size_t(1) << 20; // Bytes from which arrays are mapped directly
+const size_t HUGE_PAGE = size_t(2) << 20;
+
+enum class PagePolicy
+{
+    Default,
+    Transparent,
+    Explicit
+};
+
+inline const char *pagePolicyName(PagePolicy policy)
+{
+    switch (policy)
+    {
+    case PagePolicy::Transparent:
+        return "thp";
+    case PagePolicy::Explicit:
+        return "huge";
+    default:
+        return "default";
+    }
+}
+
+inline bool parsePagePolicy(const std::string &name, PagePolicy &policy)
+{
+    for (PagePolicy p : {PagePolicy::Default, PagePolicy::Transparent, PagePolicy::Explicit})
+    {
+        if (name == pagePolicyName(p))
+        {
+            policy = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Applies to allocations made after it is set.
+inline PagePolicy &pagePolicy()
+{
+    static PagePolicy policy = PagePolicy::Default;
+    return policy;
+}
+
+// Maps `bytes` (rounded up to HUGE_PAGE) at a HUGE_PAGE-aligned address.
+inline void *mapPages(size_t bytes)
+{
+#if defined(__linux__)
+    size_t size = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    if (pagePolicy() == PagePolicy::Explicit)
+    {
+        void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED)
+            return p;
+    }
+
+    // Over-map by one huge page and trim both ends to get the alignment
+    void *raw = mmap(nullptr, size + HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+        throw std::bad_alloc();
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = (start + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    if (aligned > start)
+        munmap(raw, aligned - start);
+    munmap(reinterpret_cast<void *>(aligned + size), start + HUGE_PAGE - aligned);
+
+    void *p = reinterpret_cast<void *>(aligned);
+    if (pagePolicy() != PagePolicy::Default)
+        madvise(p, size, MADV_HUGEPAGE);
+    return p;
+#else
+    return ::operator new(bytes);
+#endif
+}
+
+inline void unmapPages(void *p, size_t bytes)
+{
+#if defined(__linux__)
+    munmap(p, (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE);
+#else
+    ::operator delete(p);
+#endif
+}
+
+template <typename T>
+struct PageAllocator
+{
+    using value_type = T;
+
+    PageAllocator() = default;
+    template <typename U>
+    PageAllocator(const PageAllocator<U> &) {}
+
+    T *allocate(size_t n)
+    {
+        size_t bytes = n * sizeof(T);
+        return static_cast<T *>(bytes >= LARGE_ALLOCATION ? mapPages(bytes) : ::operator new(bytes));
+    }
+
+    void deallocate(T *p, size_t n)
+    {
+        size_t bytes = n * sizeof(T);
+        if (bytes >= LARGE_ALLOCATION)
+            unmapPages(p, bytes);
+        else
+            ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const PageAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const PageAllocator<U> &) const { return false; }
+};
+
+template <typename T>
+using PageVector = std::vector<T, PageAllocator<T>>;
+
+/**
+ * ------------------------------------------------------------------
+ * FUNCTION: firstTouch
+ * Faults in the unconstructed elements [begin, end) of `data` from the
+ * pool, split exactly like pool->parallelFor(end - begin). Call it
+ * between reserve() and filling the array; touching constructed
+ * elements would overwrite them.
+ * ------------------------------------------------------------------
+ */
+template <typename T>
+void firstTouch(WorkerPool *pool, T *data, size_t begin, size_t end)
+{
+    if (!pool || pool->size() < 2 || end <= begin)
+        return; // The caller's own writes place the pages just as well
+#if defined(__linux__)
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    const size_t page = 4096;
+#endif
+    char *base = reinterpret_cast<char *>(data + begin);
+    pool->parallelFor("first touch", end - begin, [&](size_t lo, size_t hi, unsigned)
+                      {
+                          char *first = base + lo * sizeof(T), *last = base + hi * sizeof(T);
+                          for (char *p = first; p < last; p += page)
+                              *reinterpret_cast<volatile char *>(p) = 0; });
+}
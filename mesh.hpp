@@ -0,0 +1,305 @@
+/**
+ * ======================================================================================
+ * MESH LOADING (Wavefront OBJ -> Cloth)
+ * ======================================================================================
+ *
+ * Turns an arbitrary triangle mesh into a cloth: every vertex becomes a
+ * Point, every distinct triangle edge becomes a Link.
+ *
+ *   OBJ ──(streaming parse)──> vertices + triangles
+ *       ──(edge dedup)───────> unique (a, b) pairs, a < b
+ *       ──(Cloth)────────────> points, links, CSR adjacency, colours (coloring.hpp)
+ *
+ * The parser reads the file in 1 MB blocks and only looks at `v` and `f`
+ * records (polygons are fan-triangulated; `f 1/2/3`, `f 1//3` and negative
+ * indices are accepted). Edges are deduplicated without sorting the whole
+ * edge list: they are bucketed by their smaller vertex (one counting pass)
+ * and each bucket, typically 3-6 entries, is sorted on its own.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include "cloth.hpp"
+#include "coloring.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+struct MeshData
+{
+    std::vector<sf::Vector3f> vertices;
+    std::vector<uint32_t> triangles; // 3 vertex indices per triangle
+};
+
+namespace detail
+{
+inline const char *skipSpaces(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    return p;
+}
+
+// Parses one `v` or `f` record. Returns false on malformed input.
+inline bool parseObjLine(const char *p, const char *end, MeshData &mesh, std::vector<uint32_t> &face)
+{
+    p = skipSpaces(p, end);
+    if (end - p < 2 || (p[1] != ' ' && p[1] != '\t'))
+        return true; // vt, vn, comments, groups, ...: not needed
+
+    if (p[0] == 'v')
+    {
+        float xyz[3];
+        p += 2;
+        for (float &v : xyz)
+        {
+            p = skipSpaces(p, end);
+            auto res = std::from_chars(p, end, v);
+            if (res.ec != std::errc())
+                return false;
+            p = res.ptr;
+        }
+        mesh.vertices.emplace_back(xyz[0], xyz[1], xyz[2]);
+        return true;
+    }
+
+    if (p[0] == 'f')
+    {
+        face.clear();
+        p += 2;
+        for (;;)
+        {
+            p = skipSpaces(p, end);
+            if (p >= end || *p == '\r')
+                break;
+            long long index = 0;
+            auto res = std::from_chars(p, end, index);
+            if (res.ec != std::errc())
+                return false;
+            p = res.ptr;
+            while (p < end && *p != ' ' && *p != '\t') // Skip /texture/normal
+                p++;
+
+            // 1-based, or negative = relative to the last vertex
+            long long resolved = index > 0 ? index - 1 : static_cast<long long>(mesh.vertices.size()) + index;
+            if (resolved < 0 || resolved >= static_cast<long long>(mesh.vertices.size()))
+                return false;
+            face.push_back(static_cast<uint32_t>(resolved));
+        }
+
+        for (size_t i = 1; i + 1 < face.size(); i++) // Fan triangulation
+        {
+            mesh.triangles.push_back(face[0]);
+            mesh.triangles.push_back(face[i]);
+            mesh.triangles.push_back(face[i + 1]);
+        }
+    }
+    return true;
+}
+} // namespace detail
+
+/**
+ * ------------------------------------------------------------------
+ * FUNCTION: loadObj
+ * Streams an OBJ file into `mesh`. On failure returns false and
+ * describes the problem in `error`.
+ * ------------------------------------------------------------------
+ */
+inline bool loadObj(const std::string &path, MeshData &mesh, std::string &error)
+{
+    mesh.vertices.clear();
+    mesh.triangles.clear();
+
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    const size_t BLOCK = 1 << 20;
+    std::vector<char> buf(BLOCK);
+    std::vector<uint32_t> face;
+    size_t carry = 0; // Bytes of an unfinished line kept from the previous block
+    size_t lineNo = 0;
+    bool ok = true;
+
+    for (;;)
+    {
+        if (carry == buf.size())
+            buf.resize(buf.size() * 2); // A single line longer than the buffer
+        size_t got = std::fread(buf.data() + carry, 1, buf.size() - carry, file);
+        size_t size = carry + got;
+        bool eof = got == 0;
+
+        const char *p = buf.data();
+        const char *end = buf.data() + size;
+        for (;;)
+        {
+            const char *nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+            if (!nl)
+            {
+                if (eof && p < end) // Last line without a newline
+                {
+                    lineNo++;
+                    ok = detail::parseObjLine(p, end, mesh, face);
+                    p = end;
+                }
+                break;
+            }
+            lineNo++;
+            if (!detail::parseObjLine(p, nl, mesh, face))
+            {
+                ok = false;
+                break;
+            }
+            p = nl + 1;
+        }
+
+        if (!ok || eof)
+            break;
+        carry = static_cast<size_t>(end - p);
+        std::memmove(buf.data(), p, carry);
+    }
+    std::fclose(file);
+
+    if (!ok)
+    {
+        error = path + ":" + std::to_string(lineNo) + ": malformed record";
+        return false;
+    }
+    if (mesh.triangles.empty())
+    {
+        error = path + ": no faces";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * FUNCTION: uniqueEdges
+ * Returns every distinct triangle edge once, as (a, b) pairs with
+ * a < b, ordered by a then b. O(vertices + triangles).
+ * ------------------------------------------------------------------
+ */
+inline std::vector<std::pair<uint32_t, uint32_t>> uniqueEdges(const MeshData &mesh)
+{
+    size_t n = mesh.vertices.size();
+    auto forEachEdge = [&](auto &&fn)
+    {
+        for (size_t t = 0; t < mesh.triangles.size(); t += 3)
+        {
+            const uint32_t *tri = &mesh.triangles[t];
+            for (int e = 0; e < 3; e++)
+            {
+                uint32_t a = tri[e], b = tri[(e + 1) % 3];
+                if (a != b)
+                    fn(std::min(a, b), std::max(a, b));
+            }
+        }
+    };
+
+    // Bucket the larger endpoint by the smaller one (counting sort)
+    std::vector<uint32_t> offset(n + 1, 0);
+    forEachEdge([&](uint32_t a, uint32_t) { offset[a + 1]++; });
+    for (size_t i = 0; i < n; i++)
+        offset[i + 1] += offset[i];
+    std::vector<uint32_t> other(offset.back());
+    std::vector<uint32_t> fill(offset.begin(), offset.end() - 1);
+    forEachEdge([&](uint32_t a, uint32_t b) { other[fill[a]++] = b; });
+
+    // Dedup within each (tiny) bucket
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    edges.reserve(offset.back() / 2 + 1); // Interior edges are shared by two triangles
+    for (size_t a = 0; a < n; a++)
+    {
+        uint32_t *first = other.data() + offset[a];
+        uint32_t *last = other.data() + offset[a + 1];
+        std::sort(first, last);
+        last = std::unique(first, last);
+        for (uint32_t *b = first; b < last; b++)
+            edges.emplace_back(static_cast<uint32_t>(a), *b);
+    }
+    return edges;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * FUNCTION: buildClothFromMesh
+ * Replaces the cloth with the mesh. The mesh is scaled to `width`
+ * pixels across, flipped to the screen's y-down convention, centred
+ * horizontally with its top at y = 0, and its topmost vertices (within
+ * 0.1% of its height) are pinned per `cloth.pinPattern`, like the grid's
+ * top row. Returns false if the links could not be coloured (some
+ * vertex has too many edges); the cloth is then marked so that the
+ * colored solver runs serially on it.
+ * ------------------------------------------------------------------
+ */
+inline bool buildClothFromMesh(Cloth &cloth, const MeshData &mesh, WorkerPool *pool = nullptr,
+                               float width = WIDTH * DISTANCE)
+{
+    const float inf = std::numeric_limits<float>::max();
+    sf::Vector3f lo(inf, inf, inf), hi(-inf, -inf, -inf);
+    for (const sf::Vector3f &v : mesh.vertices)
+    {
+        lo = {std::min(lo.x, v.x), std::min(lo.y, v.y), std::min(lo.z, v.z)};
+        hi = {std::max(hi.x, v.x), std::max(hi.y, v.y), std::max(hi.z, v.z)};
+    }
+    float extent = std::max(hi.x - lo.x, 1e-6f);
+    float scale = width / extent;
+    float pinBand = (hi.y - lo.y) * 0.001f;
+
+    cloth.clear();
+    cloth.points.reserve(static_cast<size_t>(mesh.vertices.size() * (1.f + cloth.splitReserve)));
+    firstTouch(cloth.pool, cloth.points.data(), 0, mesh.vertices.size());
+    std::vector<uint32_t> top;
+    for (const sf::Vector3f &v : mesh.vertices)
+    {
+        if (hi.y - v.y <= pinBand)
+            top.push_back(static_cast<uint32_t>(cloth.points.size()));
+        cloth.points.emplace_back((v.x - (lo.x + hi.x) / 2.f) * scale, (hi.y - v.y) * scale,
+                                  (v.z - (lo.z + hi.z) / 2.f) * scale);
+    }
+    std::sort(top.begin(), top.end(), [&](uint32_t a, uint32_t b)
+              { return cloth.points[a].pos.x < cloth.points[b].pos.x; });
+    cloth.pinTop(top);
+
+    // Colour the edges first and create the links already grouped by colour
+    // (a counting sort of 8-byte edges is much cheaper than sorting Links)
+    std::vector<std::pair<uint32_t, uint32_t>> edges = uniqueEdges(mesh);
+    std::vector<uint8_t> colors;
+    bool colored = colorEdges(cloth.points.size(), edges, pool, colors);
+    if (!colored)
+        colors.assign(edges.size(), 0); // One batch, in file order; never solved in parallel
+    cloth.colorValid = colored;
+
+    size_t start[257] = {};
+    for (uint8_t c : colors)
+        start[c + 1]++;
+    for (int c = 0; c < 256; c++)
+        start[c + 1] += start[c];
+    std::vector<uint32_t> order(edges.size());
+    for (size_t e = 0; e < edges.size(); e++)
+        order[start[colors[e]]++] = static_cast<uint32_t>(e);
+
+    cloth.links.reserve(edges.size());
+    for (int c = 0; c < 256; c++)
+        firstTouch(cloth.pool, cloth.links.data(), c ? start[c - 1] : 0, start[c]); // One colour batch each
+    for (uint32_t e : order)
+    {
+        cloth.links.emplace_back(cloth.points[edges[e].first], cloth.points[edges[e].second]);
+        cloth.links.back().color = colors[e];
+    }
+    if (colored)
+        cloth.sortByColor(); // Already in order: only records the batches
+    cloth.buildAdjacency();
+    cloth.triangles = mesh.triangles; // Vertex i is point i
+    return colored;
+}
@@ -0,0 +1,238 @@
+/**
+ * ======================================================================================
+ * WORKER POOL (Fork-join parallel loops for the solver)
+ * ======================================================================================
+ *
+ * A fixed set of threads that sleep until the caller publishes a job, all run
+ * it, and report back. The calling thread always takes part as worker 0, so
+ * a pool of size 1 has no threads and runs everything inline.
+ *
+ *   caller:   run(job) ---> job(0) ---> wait for 1..N-1 ---> return
+ *   worker i:      wake --> job(i) ---> done
+ *
+ * The solver forks many small loops per frame (one per colour per iteration),
+ * so workers spin briefly on the job counter before falling back to a
+ * condition variable; between frames they sleep and cost nothing.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+class WorkerPool
+{
+public:
+    explicit WorkerPool(unsigned threadCount = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        threadCount = std::max(1u, threadCount);
+#if defined(__linux__)
+        processCpus(); // Before any pool pins the thread creating it
+#endif
+        for (unsigned i = 1; i < threadCount; i++)
+            threads.emplace_back([this, i]() { workerLoop(i); });
+    }
+
+    ~WorkerPool()
+    {
+#if defined(__linux__)
+        if (callerPinned)
+            pthread_setaffinity_np(caller, sizeof(callerMask), &callerMask);
+#endif
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            generation.fetch_add(1, std::memory_order_release);
+        }
+        wake.notify_all();
+        for (auto &t : threads)
+            t.join();
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    // Number of workers, including the calling thread.
+    unsigned size() const { return static_cast<unsigned>(threads.size()) + 1; }
+
+    // Binds worker w (0 = the calling thread) to the w-th CPU the process
+    // may run on, wrapping around. Keeps each worker's first-touched pages
+    // on its own NUMA node. The calling thread gets its own mask back when
+    // the pool is destroyed, so the next pool it creates is not confined to
+    // one CPU. Returns false if unsupported or refused.
+    bool pinThreads()
+    {
+#if defined(__linux__)
+        const std::vector<int> &cpus = processCpus();
+        if (cpus.empty())
+            return false;
+
+        if (!callerPinned)
+        {
+            caller = pthread_self();
+            if (pthread_getaffinity_np(caller, sizeof(callerMask), &callerMask) != 0)
+                return false;
+            callerPinned = true;
+        }
+
+        bool ok = true;
+        for (unsigned w = 0; w < size(); w++)
+        {
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cpus[w % cpus.size()], &one);
+            pthread_t t = w == 0 ? pthread_self() : threads[w - 1].native_handle();
+            ok &= pthread_setaffinity_np(t, sizeof(one), &one) == 0;
+        }
+        return ok;
+#else
+        return false;
+#endif
+    }
+
+    // Runs fn(worker) once on every worker and returns when all are done.
+    // `name` labels the per-worker span in traces. Called from inside a
+    // job (a frame task sharing the pool, say), it runs every worker's
+    // share on the calling thread instead.
+    void run(const char *name, const std::function<void(unsigned)> &fn)
+    {
+        if (threads.empty() || insideJob())
+        {
+            TraceScope span(name);
+            for (unsigned w = 0; w < size(); w++)
+                fn(w);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &fn;
+            jobName = name;
+            pending.store(static_cast<unsigned>(threads.size()), std::memory_order_relaxed);
+            generation.fetch_add(1, std::memory_order_release);
+        }
+        wake.notify_all();
+
+        {
+            TraceScope span(name);
+            if (Profiler::instance().isEnabled())
+                Profiler::instance().forked(size()); // This span, and the ones around it, see ~1/size of the work
+            insideJob() = true;
+            fn(0);
+            insideJob() = false;
+        }
+
+        // Workers finish at about the same time as us; spin, don't sleep
+        while (pending.load(std::memory_order_acquire) != 0)
+            std::this_thread::yield();
+    }
+
+    // Splits [0, n) into one contiguous range per worker and runs
+    // fn(begin, end, worker) on each. Ranges depend only on n and the pool
+    // size, so the same indices always land on the same thread.
+    template <typename F>
+    void parallelFor(const char *name, size_t n, F &&fn)
+    {
+        unsigned workers = size();
+        run(name, [&](unsigned w)
+            {
+                size_t begin = n * w / workers;
+                size_t end = n * (w + 1) / workers;
+                if (begin < end)
+                    fn(begin, end, w); });
+    }
+
+private:
+#if defined(__linux__)
+    // The CPUs the process may run on, read once: by the time a second
+    // pool pins, the thread asking may itself be bound to one of them.
+    static const std::vector<int> &processCpus()
+    {
+        static const std::vector<int> cpus = []()
+        {
+            std::vector<int> list;
+            cpu_set_t allowed;
+            if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+                for (int c = 0; c < CPU_SETSIZE; c++)
+                    if (CPU_ISSET(c, &allowed))
+                        list.push_back(c);
+            return list;
+        }();
+        return cpus;
+    }
+
+    pthread_t caller{};
+    cpu_set_t callerMask{};
+    bool callerPinned = false;
+#endif
+
+    static bool &insideJob()
+    {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    void workerLoop(unsigned id)
+    {
+        Tracer::instance().setThreadName("pool worker " + std::to_string(id));
+        unsigned seen = 0;
+        for (;;)
+        {
+            // Spin for a short while: the next fork usually follows within microseconds
+            unsigned gen = generation.load(std::memory_order_acquire);
+            for (int spin = 0; gen == seen && spin < 4000; spin++)
+            {
+                std::this_thread::yield();
+                gen = generation.load(std::memory_order_acquire);
+            }
+            if (gen == seen)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return generation.load(std::memory_order_acquire) != seen; });
+                gen = generation.load(std::memory_order_acquire);
+            }
+            seen = gen;
+
+            const std::function<void(unsigned)> *fn;
+            const char *name;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stopping)
+                    return;
+                fn = job;
+                name = jobName;
+            }
+
+            {
+                TraceScope span(name);
+                insideJob() = true;
+                (*fn)(id);
+                insideJob() = false;
+            }
+            pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::atomic<unsigned> generation{0};
+    std::atomic<unsigned> pending{0};
+    const std::function<void(unsigned)> *job = nullptr;
+    const char *jobName = "";
+    bool stopping = false;
+};
@@ -0,0 +1,128 @@
+/**
+ * ======================================================================================
+ * HARDWARE PERFORMANCE COUNTERS (Linux perf_event_open)
+ * ======================================================================================
+ *
+ * Reads cycles, instructions, last-level-cache misses, branch mispredicts
+ * and data-TLB misses for the calling thread, so a phase can be classified
+ * as memory bound (low IPC, many LLC misses per link) or compute bound (high
+ * IPC), and the effect of huge pages seen directly.
+ *
+ * All counters are opened as one group and read with a single read(), so
+ * they cover exactly the same instructions. Counters the CPU or kernel does
+ * not offer (VMs, containers, perf_event_paranoid) are simply missing:
+ * `available(c)` is false and the reports print "-". On other platforms
+ * nothing is opened at all.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum PerfCounter
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_COUNTER_COUNT
+};
+
+using PerfSample = std::array<uint64_t, PERF_COUNTER_COUNT>;
+
+class PerfCounters
+{
+public:
+    PerfCounters()
+    {
+#if defined(__linux__)
+        const uint64_t llcReadMiss = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        const uint64_t dtlbReadMiss = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        open(PERF_CYCLES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        open(PERF_INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        if (!open(PERF_LLC_MISSES, PERF_TYPE_HW_CACHE, llcReadMiss))
+            open(PERF_LLC_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        open(PERF_BRANCH_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        open(PERF_DTLB_MISSES, PERF_TYPE_HW_CACHE, dtlbReadMiss);
+
+        if (leader >= 0)
+        {
+            ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    ~PerfCounters()
+    {
+#if defined(__linux__)
+        for (int fd : fds)
+            if (fd >= 0)
+                close(fd);
+#endif
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool any() const { return leader >= 0; }
+    bool available(PerfCounter c) const { return slot[c] >= 0; }
+
+    // Current totals since construction (0 for unavailable counters).
+    PerfSample read() const
+    {
+        PerfSample sample{};
+#if defined(__linux__)
+        if (leader < 0)
+            return sample;
+        uint64_t buf[1 + PERF_COUNTER_COUNT] = {};
+        if (::read(leader, buf, sizeof(buf)) <= 0)
+            return sample;
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+            if (slot[c] >= 0 && static_cast<uint64_t>(slot[c]) < buf[0])
+                sample[c] = buf[1 + slot[c]];
+#endif
+        return sample;
+    }
+
+private:
+#if defined(__linux__)
+    bool open(PerfCounter c, uint32_t type, uint64_t config)
+    {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = leader < 0; // The group starts when the leader is enabled
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+
+        int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0));
+        if (fd < 0)
+            return false;
+        if (leader < 0)
+            leader = fd;
+        slot[c] = members++;
+        fds[c] = fd;
+        return true;
+    }
+
+    std::array<int, PERF_COUNTER_COUNT> fds{{-1, -1, -1, -1, -1}};
+#endif
+    int leader = -1;
+    int members = 0;
+    std::array<int, PERF_COUNTER_COUNT> slot{{-1, -1, -1, -1, -1}}; // Position in the group read
+};
@@ -0,0 +1,154 @@
+/**
+ * ======================================================================================
+ * PHASE PROFILER (Wall time + hardware counters per frame phase)
+ * ======================================================================================
+ *
+ * Every TraceScope span (see trace.hpp) also feeds the profiler when it is
+ * enabled, so the phases are instrumented in one place. The profiler keeps a
+ * running sum per span name for the thread that enabled it and prints
+ *
+ *   phase        ms/frame      IPC   LLC miss/link   br miss/link
+ *   solve           0.412     2.91           0.003          0.010
+ *
+ * where "per link" divides by the live link count of the frame, i.e. the
+ * solve row counts all iterations of a frame against each link once.
+ *
+ * The counters are per thread, so they only see the enabling thread's
+ * share of a phase. A phase that forks the worker pool (WorkerPool::run
+ * reports the fork) hands that thread ~1/T of the links with T workers,
+ * so its per-link values divide by links / T instead; phases that never
+ * fork are counted whole. The "workers" column shows T.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include "perfcounters.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+struct PhaseTotals
+{
+    const char *name;
+    uint64_t calls = 0;
+    double ns = 0.0;
+    PerfSample counters{};
+    unsigned workers = 1; // Largest pool fork seen inside the phase
+};
+
+class Profiler
+{
+public:
+    static Profiler &instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    // Samples only the calling thread (the counters are per thread).
+    void enable()
+    {
+        if (!counters)
+            counters = std::make_unique<PerfCounters>();
+        owner = std::this_thread::get_id();
+        enabled.store(true, std::memory_order_release);
+    }
+
+    bool isEnabled() const
+    {
+        return enabled.load(std::memory_order_acquire) && std::this_thread::get_id() == owner;
+    }
+    bool hasCounters() const { return counters && counters->any(); }
+    const PerfCounters *perf() const { return counters.get(); }
+
+    struct Mark
+    {
+        std::chrono::steady_clock::time_point time;
+        PerfSample counters;
+        unsigned outerFork; // The enclosing span's fork width so far
+    };
+
+    Mark begin()
+    {
+        Mark m{std::chrono::steady_clock::now(), counters->read(), fork};
+        fork = 1;
+        return m;
+    }
+
+    void end(const char *name, const Mark &start)
+    {
+        PerfSample now = counters->read();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start.time).count();
+
+        PhaseTotals &t = totals(name);
+        t.calls++;
+        t.ns += ns;
+        t.workers = std::max(t.workers, fork);
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+            t.counters[c] += now[c] - start.counters[c];
+        fork = std::max(fork, start.outerFork); // A fork inside also forks the enclosing span
+    }
+
+    // Called by WorkerPool::run on the profiled thread: the open spans
+    // share their work with `workers` threads.
+    void forked(unsigned workers) { fork = std::max(fork, workers); }
+
+    // Running sums since the last reset(), in first-seen order.
+    const std::vector<PhaseTotals> &phases() const { return table; }
+
+    void reset() { table.clear(); }
+
+    // Prints averages over `frames` frames with `links` live links, then resets.
+    void report(uint64_t frames, size_t links)
+    {
+        if (frames == 0)
+            return;
+
+        std::printf("%-16s %10s %8s %14s %14s %14s %8s\n", "phase", "ms/frame", "IPC", "LLC miss/link",
+                    "br miss/link", "TLB miss/link", "workers");
+        for (const PhaseTotals &t : table)
+        {
+            uint64_t share = frames * links / t.workers; // Link-frames this thread handled
+            std::printf("%-16s %10.3f", t.name, t.ns / frames / 1e6);
+            printRatio(t.counters[PERF_INSTRUCTIONS], t.counters[PERF_CYCLES], PERF_INSTRUCTIONS, PERF_CYCLES, 8);
+            printRatio(t.counters[PERF_LLC_MISSES], share, PERF_LLC_MISSES, PERF_LLC_MISSES, 14);
+            printRatio(t.counters[PERF_BRANCH_MISSES], share, PERF_BRANCH_MISSES, PERF_BRANCH_MISSES, 14);
+            printRatio(t.counters[PERF_DTLB_MISSES], share, PERF_DTLB_MISSES, PERF_DTLB_MISSES, 14);
+            std::printf(" %8u\n", t.workers);
+        }
+        if (!hasCounters())
+            std::printf("(hardware counters unavailable: check /proc/sys/kernel/perf_event_paranoid)\n");
+        std::printf("\n");
+        reset();
+    }
+
+private:
+    PhaseTotals &totals(const char *name)
+    {
+        for (PhaseTotals &t : table)
+            if (t.name == name || std::strcmp(t.name, name) == 0)
+                return t;
+        table.push_back(PhaseTotals{name});
+        return table.back();
+    }
+
+    void printRatio(uint64_t num, uint64_t den, PerfCounter a, PerfCounter b, int width) const
+    {
+        if (hasCounters() && counters->available(a) && counters->available(b) && den > 0)
+            std::printf(" %*.3f", width, static_cast<double>(num) / den);
+        else
+            std::printf(" %*s", width, "-");
+    }
+
+    std::atomic<bool> enabled{false};
+    std::thread::id owner;
+    std::unique_ptr<PerfCounters> counters;
+    std::vector<PhaseTotals> table;
+    unsigned fork = 1; // Widest pool fork inside the innermost open span
+};
@@ -0,0 +1,104 @@
+/**
+ * ======================================================================================
+ * SPATIAL INDEX (Uniform grid over the points' x/y)
+ * ======================================================================================
+ *
+ * Buckets point indices into square cells of the x/y plane, stored CSR
+ * style (one counting pass, one prefix sum, one fill), so "which points
+ * lie in this rectangle" visits only the overlapping cells:
+ *
+ *   cellStart: [0, 2, 2, 5, ...]      cell c holds items[cellStart[c] .. cellStart[c + 1])
+ *   items:     [7, 9, | | 1, 3, 4, ...]
+ *
+ * z is not bucketed (the cloth is roughly a sheet facing the camera), but
+ * its range is kept so callers can widen screen-space queries for depth.
+ * The grid is a snapshot: rebuild it when the points have moved.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include "cloth.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+struct SpatialGrid
+{
+    float cell = DISTANCE;
+    float minX = 0.f, minY = 0.f;
+    float minZ = 0.f, maxZ = 0.f;
+    int cols = 0, rows = 0;
+    std::vector<uint32_t> cellStart;
+    std::vector<uint32_t> items;
+
+    // Cells are at least `cellSize` wide, and there are never more cells than points.
+    void build(const PageVector<Point> &points, float cellSize = 2.f * DISTANCE)
+    {
+        const float inf = std::numeric_limits<float>::max();
+        float maxX = -inf, maxY = -inf;
+        minX = minY = minZ = inf;
+        maxZ = -inf;
+        for (const Point &p : points)
+        {
+            minX = std::min(minX, p.pos.x);
+            maxX = std::max(maxX, p.pos.x);
+            minY = std::min(minY, p.pos.y);
+            maxY = std::max(maxY, p.pos.y);
+            minZ = std::min(minZ, p.pos.z);
+            maxZ = std::max(maxZ, p.pos.z);
+        }
+        if (points.empty())
+        {
+            cols = rows = 0;
+            cellStart.assign(1, 0);
+            items.clear();
+            return;
+        }
+
+        float area = std::max((maxX - minX) * (maxY - minY), 1e-6f);
+        cell = std::max(cellSize, std::sqrt(area / points.size()));
+        cols = static_cast<int>((maxX - minX) / cell) + 1;
+        rows = static_cast<int>((maxY - minY) / cell) + 1;
+
+        cellStart.assign(static_cast<size_t>(cols) * rows + 1, 0);
+        for (const Point &p : points)
+            cellStart[cellOf(p.pos.x, p.pos.y) + 1]++;
+        for (size_t c = 0; c + 1 < cellStart.size(); c++)
+            cellStart[c + 1] += cellStart[c];
+
+        items.resize(points.size());
+        fill.assign(cellStart.begin(), cellStart.end() - 1);
+        for (size_t i = 0; i < points.size(); i++)
+            items[fill[cellOf(points[i].pos.x, points[i].pos.y)]++] = static_cast<uint32_t>(i);
+    }
+
+    // Calls fn(point) for every point in a cell overlapping [x0, x1] x [y0, y1]
+    // (a superset of the points inside it).
+    template <typename F>
+    void query(float x0, float y0, float x1, float y1, F &&fn) const
+    {
+        if (cols == 0)
+            return;
+        int cx0 = clampCol(x0), cx1 = clampCol(x1);
+        int cy0 = clampRow(y0), cy1 = clampRow(y1);
+        for (int cy = cy0; cy <= cy1; cy++)
+        {
+            for (int cx = cx0; cx <= cx1; cx++)
+            {
+                size_t c = static_cast<size_t>(cy) * cols + cx;
+                for (uint32_t i = cellStart[c]; i < cellStart[c + 1]; i++)
+                    fn(items[i]);
+            }
+        }
+    }
+
+private:
+    std::vector<uint32_t> fill; // Build scratch, kept for the next build
+
+    int clampCol(float x) const { return std::clamp(static_cast<int>(std::floor((x - minX) / cell)), 0, cols - 1); }
+    int clampRow(float y) const { return std::clamp(static_cast<int>(std::floor((y - minY) / cell)), 0, rows - 1); }
+    size_t cellOf(float x, float y) const { return static_cast<size_t>(clampRow(y)) * cols + clampCol(x); }
+};
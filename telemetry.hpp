@@ -0,0 +1,213 @@
+/**
+ * ======================================================================================
+ * TELEMETRY (Per-frame stats in POSIX shared memory)
+ * ======================================================================================
+ *
+ * The simulation publishes one record per frame into a ring buffer living in
+ * a shared-memory object, so a dashboard in another process can watch it
+ * with no sockets and no syscalls on the writer's side.
+ *
+ *   +--------------------+------------+------------+-----+----------------+
+ *   | TelemetryHeader    | slot 0     | slot 1     | ... | slot CAP-1     |
+ *   | magic, version,    | seq | rec  | seq | rec  |     | seq | rec      |
+ *   | sizes, head        |            |            |     |                |
+ *   +--------------------+------------+------------+-----+----------------+
+ *
+ * Frame n goes to slot n % capacity. Each slot is a seqlock: the writer
+ * makes `seq` odd, writes the record, then makes it even again. A reader
+ * copies the record between two reads of `seq` and retries if they differ
+ * or are odd, so it never sees a torn record and never blocks the writer.
+ *
+ * The layout is fixed (static_asserts below) and versioned: bump
+ * TELEMETRY_VERSION whenever TelemetryRecord changes.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define FABRIC_HAS_SHM 1
+#else
+#define FABRIC_HAS_SHM 0
+#endif
+
+const uint32_t TELEMETRY_MAGIC = 0x46414254; // "FABT"
+const uint32_t TELEMETRY_VERSION = 1;
+const uint32_t TELEMETRY_CAPACITY = 1024;    // Frames kept in the ring (~17 s at 60 FPS)
+const char *const TELEMETRY_DEFAULT_NAME = "/fabric_telemetry";
+
+// One frame's worth of stats. Plain 4/8-byte fields only.
+struct TelemetryRecord
+{
+    uint64_t frame;       // Frame number, also tells the reader the slot is current
+    float frameMillis;    // Wall time of the whole frame
+    float residual;       // Mean |dist - rest| / rest after the last solver pass
+    uint32_t liveLinks;   // Links left after compaction
+    uint32_t tears;       // Links removed this frame
+    float tearRate;       // Tears per second, smoothed over ~1 s
+    uint32_t reserved;    // Keeps the record a multiple of 8 bytes
+};
+
+struct TelemetrySlot
+{
+    std::atomic<uint32_t> seq;
+    uint32_t pad;
+    // The record is copied word by word through relaxed atomics, so the
+    // concurrent read/write the seqlock tolerates is not a data race.
+    std::atomic<uint32_t> words[sizeof(TelemetryRecord) / 4];
+};
+
+struct TelemetryHeader
+{
+    std::atomic<uint32_t> magic; // Stored last (release); readers load it with acquire
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t slotSize;
+    uint32_t capacity;
+    uint32_t pad;
+    std::atomic<uint64_t> head; // Number of frames published so far
+};
+
+static_assert(sizeof(TelemetryRecord) == 32, "TelemetryRecord layout changed: bump TELEMETRY_VERSION");
+static_assert(sizeof(TelemetrySlot) == 40, "TelemetrySlot layout changed: bump TELEMETRY_VERSION");
+static_assert(sizeof(TelemetryHeader) == 32, "TelemetryHeader layout changed: bump TELEMETRY_VERSION");
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "shared-memory atomics must be lock-free");
+
+inline size_t telemetryBytes()
+{
+    return sizeof(TelemetryHeader) + sizeof(TelemetrySlot) * TELEMETRY_CAPACITY;
+}
+
+inline TelemetrySlot *telemetrySlots(TelemetryHeader *header)
+{
+    return reinterpret_cast<TelemetrySlot *>(reinterpret_cast<char *>(header) + sizeof(TelemetryHeader));
+}
+
+/**
+ * ------------------------------------------------------------------
+ * CLASS: TelemetryWriter
+ * Creates (or replaces) the shared-memory object and publishes one
+ * record per frame. Unlinks the object again on destruction.
+ * ------------------------------------------------------------------
+ */
+class TelemetryWriter
+{
+public:
+    TelemetryWriter() = default;
+    TelemetryWriter(const TelemetryWriter &) = delete;
+    TelemetryWriter &operator=(const TelemetryWriter &) = delete;
+    ~TelemetryWriter() { close(); }
+
+    bool open(const std::string &name = TELEMETRY_DEFAULT_NAME)
+    {
+#if FABRIC_HAS_SHM
+        close();
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+        if (fd < 0)
+            return false;
+        if (ftruncate(fd, static_cast<off_t>(telemetryBytes())) != 0)
+        {
+            ::close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+        void *mem = mmap(nullptr, telemetryBytes(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mem == MAP_FAILED)
+        {
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        // Readers wait for the magic, so publish it (release) after everything else
+        header = static_cast<TelemetryHeader *>(mem);
+        std::memset(mem, 0, telemetryBytes());
+        header->version = TELEMETRY_VERSION;
+        header->headerSize = sizeof(TelemetryHeader);
+        header->slotSize = sizeof(TelemetrySlot);
+        header->capacity = TELEMETRY_CAPACITY;
+        header->magic.store(TELEMETRY_MAGIC, std::memory_order_release);
+        shmName = name;
+        return true;
+#else
+        (void)name;
+        return false;
+#endif
+    }
+
+    void close()
+    {
+#if FABRIC_HAS_SHM
+        if (!header)
+            return;
+        munmap(header, telemetryBytes());
+        shm_unlink(shmName.c_str());
+        header = nullptr;
+#endif
+    }
+
+    bool isOpen() const { return header != nullptr; }
+
+    // Publishes `rec` as frame rec.frame. Wait-free: a handful of stores.
+    void publish(const TelemetryRecord &rec)
+    {
+        if (!header)
+            return;
+
+        uint32_t words[sizeof(TelemetryRecord) / 4];
+        std::memcpy(words, &rec, sizeof(rec));
+
+        TelemetrySlot &slot = telemetrySlots(header)[rec.frame % TELEMETRY_CAPACITY];
+        uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+        slot.seq.store(seq + 1, std::memory_order_relaxed); // Odd: write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < sizeof(words) / 4; i++)
+            slot.words[i].store(words[i], std::memory_order_relaxed);
+        slot.seq.store(seq + 2, std::memory_order_release); // Even: record complete
+
+        header->head.store(rec.frame + 1, std::memory_order_release);
+    }
+
+private:
+    TelemetryHeader *header = nullptr;
+    std::string shmName;
+};
+
+/**
+ * ------------------------------------------------------------------
+ * FUNCTION: readTelemetrySlot
+ * Seqlock read of the record for `frame`. Returns false if the slot
+ * has already been reused for a newer frame (the reader fell behind
+ * by more than TELEMETRY_CAPACITY frames).
+ * ------------------------------------------------------------------
+ */
+inline bool readTelemetrySlot(const TelemetryHeader *header, uint64_t frame, TelemetryRecord &out)
+{
+    const TelemetrySlot &slot = telemetrySlots(const_cast<TelemetryHeader *>(header))[frame % TELEMETRY_CAPACITY];
+    uint32_t words[sizeof(TelemetryRecord) / 4];
+
+    for (;;)
+    {
+        uint32_t before = slot.seq.load(std::memory_order_acquire);
+        if (before & 1)
+            continue; // Writer is mid-update
+        for (size_t i = 0; i < sizeof(words) / 4; i++)
+            words[i] = slot.words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == before)
+            break;
+    }
+
+    std::memcpy(&out, words, sizeof(out));
+    return out.frame == frame;
+}
@@ -0,0 +1,105 @@
+/**
+ * ======================================================================================
+ * TELEMETRY READER
+ * ======================================================================================
+ *
+ * Tails the per-frame stats that `./fabric --telemetry` publishes in shared
+ * memory (see telemetry.hpp) and prints one line per frame.
+ *
+ *   ./telemetry_reader [name] [--every N]
+ *
+ * `name` defaults to /fabric_telemetry. `--every N` prints every Nth frame.
+ * Frames the reader was too slow to see before the ring wrapped are counted
+ * as dropped instead of being printed with stale data.
+ *
+ * Build: g++ telemetry_reader.cpp -o telemetry_reader -std=c++17
+ * ======================================================================================
+ */
+
+#include "telemetry.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+int main(int argc, char **argv)
+{
+#if FABRIC_HAS_SHM
+    const char *name = TELEMETRY_DEFAULT_NAME;
+    uint64_t every = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--every") == 0 && i + 1 < argc)
+            every = std::max(1, std::atoi(argv[++i]));
+        else
+            name = argv[i];
+    }
+
+    // Wait for the simulation to create the channel
+    int fd = -1;
+    while ((fd = shm_open(name, O_RDONLY, 0)) < 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    void *mem = mmap(nullptr, telemetryBytes(), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED)
+    {
+        std::perror("mmap");
+        return 1;
+    }
+
+    const TelemetryHeader *header = static_cast<const TelemetryHeader *>(mem);
+    // Acquire pairs with the writer's release: the rest of the header is set by then
+    while (header->magic.load(std::memory_order_acquire) != TELEMETRY_MAGIC)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    if (header->version != TELEMETRY_VERSION || header->slotSize != sizeof(TelemetrySlot) ||
+        header->capacity != TELEMETRY_CAPACITY)
+    {
+        std::fprintf(stderr, "%s: layout version %u, this reader understands %u\n", name, header->version,
+                     TELEMETRY_VERSION);
+        return 1;
+    }
+
+    std::printf("%10s %10s %12s %10s %6s %10s\n", "frame", "ms", "residual", "links", "tears", "tears/s");
+    uint64_t next = header->head.load(std::memory_order_acquire);
+    uint64_t dropped = 0;
+    for (;;)
+    {
+        uint64_t head = header->head.load(std::memory_order_acquire);
+        if (head < next) // The simulation restarted
+            next = head;
+        if (head - next > TELEMETRY_CAPACITY)
+        {
+            dropped += head - next - TELEMETRY_CAPACITY;
+            next = head - TELEMETRY_CAPACITY;
+        }
+
+        for (; next < head; next++)
+        {
+            TelemetryRecord rec;
+            if (!readTelemetrySlot(header, next, rec))
+            {
+                dropped++;
+                continue;
+            }
+            if (rec.frame % every == 0)
+                std::printf("%10llu %10.3f %12.6f %10u %6u %10.1f\n", static_cast<unsigned long long>(rec.frame),
+                            rec.frameMillis, rec.residual, rec.liveLinks, rec.tears, rec.tearRate);
+        }
+        if (dropped)
+        {
+            std::printf("(%llu frames dropped)\n", static_cast<unsigned long long>(dropped));
+            dropped = 0;
+        }
+        std::fflush(stdout);
+        std::this_thread::sleep_for(std::chrono::milliseconds(16));
+    }
+#else
+    (void)argc;
+    (void)argv;
+    std::fprintf(stderr, "Shared-memory telemetry needs a POSIX system\n");
+    return 1;
+#endif
+}
@@ -0,0 +1,236 @@
+/**
+ * ======================================================================================
+ * EVENT TRACER (Chrome trace / Perfetto JSON export)
+ * ======================================================================================
+ *
+ * Records begin/end spans per thread so stalls and load imbalance show up on
+ * a timeline instead of disappearing into per-phase averages.
+ *
+ *   main thread  |events|grab|cut|====solve====|compact|integrate|==render==|
+ *   worker 0     |===job===|=====job=====|==job==|
+ *   worker 1     |=====job=====|===job===|
+ *
+ * Each thread appends into its own fixed-size buffer (single writer, no
+ * locks); the buffer's length is published with a release store, so the
+ * dumping thread can read everything written so far while workers keep
+ * going. A mutex is only taken the first time a thread records a span,
+ * which is also when its buffer is allocated: threads that never record
+ * (tracing off) cost nothing. When a thread exits, its spans are copied
+ * into an array of their own size for later dumps and the full buffer
+ * goes to a free list for the next thread.
+ *
+ * The dump is Chrome's JSON trace format ("X" complete events), which
+ * chrome://tracing and ui.perfetto.dev open directly from a local file.
+ *
+ * ======================================================================================
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "profiler.hpp"
+
+const size_t TRACE_EVENTS_PER_THREAD = 1 << 18; // ~6 MB per thread, several minutes of frames
+
+struct TraceEvent
+{
+    const char *name; // Must be a string literal (stored by pointer)
+    int64_t beginNs;
+    int64_t endNs;
+};
+
+class Tracer
+{
+public:
+    static Tracer &instance()
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    void setEnabled(bool on) { enabled.store(on, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    int64_t now() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    // Names the calling thread in the trace viewer. Only stores the name;
+    // the buffer comes with the first span.
+    void setThreadName(const std::string &name)
+    {
+        ThreadSlot &slot = threadSlot();
+        slot.name = name;
+        if (slot.buf)
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            slot.buf->name = name;
+        }
+    }
+
+    void record(const char *name, int64_t beginNs, int64_t endNs)
+    {
+        ThreadBuffer &buf = local();
+        size_t n = buf.count.load(std::memory_order_relaxed);
+        if (n == TRACE_EVENTS_PER_THREAD)
+        {
+            buf.dropped++;
+            return;
+        }
+        buf.events[n] = {name, beginNs, endNs};
+        buf.count.store(n + 1, std::memory_order_release);
+    }
+
+    // Writes every span recorded so far. Safe to call while other threads record.
+    bool dump(const std::string &path)
+    {
+        std::ofstream out(path);
+        if (!out)
+            return false;
+
+        out << std::fixed << std::setprecision(3); // Microseconds with ns resolution
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto &buf : buffers)
+        {
+            out << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buf->tid
+                << ",\"args\":{\"name\":\"" << buf->name << "\"}}";
+            first = false;
+
+            size_t n = buf->count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < n; i++)
+            {
+                const TraceEvent &e = buf->events[i];
+                out << ",\n{\"ph\":\"X\",\"name\":\"" << e.name << "\",\"pid\":1,\"tid\":" << buf->tid
+                    << ",\"ts\":" << e.beginNs / 1000.0 << ",\"dur\":" << (e.endNs - e.beginNs) / 1000.0 << "}";
+            }
+        }
+        out << "\n]}\n";
+        return static_cast<bool>(out);
+    }
+
+private:
+    struct ThreadBuffer
+    {
+        std::unique_ptr<TraceEvent[]> events; // TRACE_EVENTS_PER_THREAD; trimmed to `count` once the thread exits
+        std::atomic<size_t> count{0};
+        size_t dropped = 0;
+        int tid = 0;
+        std::string name;
+    };
+
+    // The calling thread's name and buffer; hands the buffer back when the
+    // thread exits (thread_locals go before the static tracer).
+    struct ThreadSlot
+    {
+        ThreadBuffer *buf = nullptr;
+        std::string name;
+
+        ~ThreadSlot()
+        {
+            if (buf)
+                Tracer::instance().retire(*buf);
+        }
+    };
+
+    Tracer() : epoch(std::chrono::steady_clock::now()) {}
+
+    static ThreadSlot &threadSlot()
+    {
+        thread_local ThreadSlot slot;
+        return slot;
+    }
+
+    // Buffers that recorded anything live as long as the tracer, so a
+    // thread that exits still shows up in later dumps.
+    ThreadBuffer &local()
+    {
+        ThreadSlot &slot = threadSlot();
+        if (!slot.buf)
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            buffers.push_back(std::make_unique<ThreadBuffer>());
+            ThreadBuffer *buf = buffers.back().get();
+            if (spare.empty())
+                buf->events.reset(new TraceEvent[TRACE_EVENTS_PER_THREAD]);
+            else
+            {
+                buf->events = std::move(spare.back());
+                spare.pop_back();
+            }
+            buf->tid = static_cast<int>(buffers.size());
+            buf->name = slot.name.empty() ? "thread " + std::to_string(buf->tid) : slot.name;
+            slot.buf = buf;
+        }
+        return *slot.buf;
+    }
+
+    // Keeps an exiting thread's spans in an array of their own size and
+    // puts its full buffer on the free list.
+    void retire(ThreadBuffer &buf)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        size_t n = buf.count.load(std::memory_order_relaxed);
+        std::unique_ptr<TraceEvent[]> kept(new TraceEvent[n]);
+        std::copy(buf.events.get(), buf.events.get() + n, kept.get());
+        spare.push_back(std::move(buf.events));
+        buf.events = std::move(kept);
+    }
+
+    std::atomic<bool> enabled{false};
+    std::chrono::steady_clock::time_point epoch;
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::vector<std::unique_ptr<TraceEvent[]>> spare; // Full-size buffers of exited threads
+};
+
+/**
+ * ------------------------------------------------------------------
+ * STRUCT: TraceScope
+ * Records one span from construction to destruction, and feeds the
+ * same span to the phase profiler (profiler.hpp) when that is on.
+ * Costs two flag checks when both are off.
+ *
+ *   { TraceScope span("solve"); ... }
+ * ------------------------------------------------------------------
+ */
+struct TraceScope
+{
+    const char *name;
+    int64_t begin = -1;
+    bool profiled = false;
+    Profiler::Mark mark;
+
+    explicit TraceScope(const char *spanName) : name(spanName)
+    {
+        if (Tracer::instance().isEnabled())
+            begin = Tracer::instance().now();
+        if (Profiler::instance().isEnabled())
+        {
+            profiled = true;
+            mark = Profiler::instance().begin();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (profiled)
+            Profiler::instance().end(name, mark);
+        if (begin >= 0)
+            Tracer::instance().record(name, begin, Tracer::instance().now());
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+};